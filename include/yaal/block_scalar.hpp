@@ -0,0 +1,324 @@
+#pragma once
+
+#include "parser_base.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+namespace yaal {
+
+// ParserBase kernel with YAML-style block scalars.
+//
+// A statement whose last non-space byte is '|' or '>' owns a block scalar:
+// every following line indented deeper than the owner is literal text, so
+// no bos is emitted for it. The block is reported once, before the
+// statement that closes it (or before eod), through
+// on_block_scalar(begin, end): begin is the first byte after the marker
+// line, end the '\n' closing the last non-blank block line (begin when the
+// block is empty). Blank lines belong to the block, and eol is still
+// emitted for every line.
+//
+// Markers are found with masks: the marker mask shifted by one is added to
+// the space mask, so the carry runs over trailing spaces and lands on the
+// '\n' only when nothing else follows, carrying across blocks like need_bos.
+// A 64-byte block without a '|' or '>' byte, outside a block scalar, costs
+// ParserBase plus one more compare. Inside a block scalar, a block whose bos
+// are all indented deeper than the owner (two more mask additions, see
+// shallow_bos) is all block text and only emits its eols. Both tests are
+// first tried on four blocks at once with a single branch. Blocks that fail
+// them walk their bos bits and compare indentations.
+//
+// Derived provides on_block_scalar(size_t begin, size_t end) in addition to
+// the ParserBase callbacks; batch support works as in ParserBase.
+template<typename Derived>
+class BlockScalarParserBase {
+public:
+    __attribute__((flatten, hot, noinline))
+    void parse(const Buffer& buf) {
+        const char* data = buf.start();
+        const size_t len = buf.len();
+
+        begin_document(derived(), buf);
+
+        if (len == 0) {
+            derived().on_eod(0);
+            return;
+        }
+
+        data_ = data;
+        block_ = OpenBlock{};
+        Carry carry;
+
+        // Tail padded with spaces, which produce no event and end no marker
+        // line; built up front so the block loop makes no calls
+        char tail[64];
+        const size_t tail_pos = len & ~size_t(63);
+        std::memset(tail, ' ', sizeof(tail));
+        std::memcpy(tail, data + tail_pos, len - tail_pos);
+
+        size_t pos = 0;
+        while (pos < len) {
+            // Blocks that need no walk, with every carry in a register
+            Masks masks;
+            const char* block;
+            do {
+                if (pos + 256 <= tail_pos && fast_group(carry, data + pos, pos)) {
+                    pos += 256;
+                    continue;
+                }
+                block = pos < tail_pos ? data + pos : tail;
+                if (!fast_block(carry, masks, block, pos)) break;
+                pos += 64;
+            } while (pos < len);
+            if (pos >= len) break;
+
+            carry.width = slow_block(block, masks.nl, masks.sp, masks.bos, pos);
+            pos += 64;
+        }
+
+        if (block_.open) {
+            derived().on_block_scalar(block_.span_begin, span_end(len));
+        }
+
+        derived().on_eod(len);
+    }
+
+private:
+    // Carry::width doubles as the mode: plain outside a block scalar with no
+    // marker state pending, owner indentation + 1 (below 64) inside one, and
+    // slow for anything else, which sends every block through slow_block
+    static constexpr uint64_t plain = 0;
+    static constexpr uint64_t slow = 64;
+
+    // Carried from block to block, kept in registers by the hot loop
+    struct Carry {
+        uint8_t need_bos = true;
+        uint64_t width = plain;
+        uint64_t prev_sp = 0;  // space mask of the previous block
+    };
+
+    // Marker carries and the open block scalar, only touched by blocks that
+    // contain a marker byte or close a block scalar
+    struct OpenBlock {
+        uint8_t in_run = false;   // marker run of spaces crosses the block end
+        uint64_t marker_top = 0;  // marker in the last byte of the previous block
+        bool open = false;
+        size_t owner_indent = 0;
+        size_t span_begin = 0;
+    };
+
+    OpenBlock block_;
+    const char* data_ = nullptr;
+
+    Derived& derived() { return static_cast<Derived&>(*this); }
+
+    __attribute__((always_inline, hot))
+    static uint64_t add_with_carry(uint64_t a, uint64_t b, uint8_t& carry) {
+        unsigned long long sum;
+        carry = _addcarry_u64(carry, a, b, &sum);
+        return sum;
+    }
+
+    // Bos bits of a block scalar block indented at most owner (width - 1)
+    // spaces, i.e. the lines that may close it, without walking them.
+    //
+    // A bos is deeper than the owner when the width bytes before it are all
+    // spaces. The bit width bytes before each bos is added back to the space
+    // mask, and the carry reaches the bos only across such a run. A bit from
+    // a later, shorter line can land in the same run, but that line is
+    // itself shallow, so the block still goes to slow_block. Spaces ending
+    // the previous block enter as the carry-in.
+    __attribute__((always_inline))
+    static uint64_t shallow_bos(Carry& carry, uint64_t sp_mask, uint64_t bos_mask) {
+        uint8_t continued = _tzcnt_u64(bos_mask) + _lzcnt_u64(~carry.prev_sp) >= carry.width;
+        const uint64_t reached = add_with_carry(sp_mask, (bos_mask >> carry.width) & sp_mask, continued);
+        carry.prev_sp = sp_mask;
+        return bos_mask & ~reached;
+    }
+
+    // '|' or '>' bytes of a 64-byte block
+    __attribute__((always_inline))
+    static uint64_t marker_mask_of(const char* p) {
+        const __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        return load_mask(c0, c1, '|') | load_mask(c0, c1, '>');
+    }
+
+    // Four blocks at once when none needs a walk: their masks are computed
+    // side by side and one branch on the combined markers (outside a block
+    // scalar) or shallow bos (inside one) decides. Carries are committed
+    // only on success; otherwise fast_block redoes the blocks one by one.
+    __attribute__((always_inline, hot))
+    bool fast_group(Carry& carry, const char* p, size_t base) {
+        if (carry.width >= slow) return false;
+
+        const __m256i pipe_vec = _mm256_set1_epi8('|');
+        const __m256i gt_vec = _mm256_set1_epi8('>');
+        uint64_t nl_mask[4];
+        uint64_t sp_mask[4];
+        uint64_t bos_mask[4];
+        __m256i markers = _mm256_setzero_si256();
+        uint8_t need_bos = carry.need_bos;
+
+        for (int b = 0; b < 4; b++) {
+            const __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 64 * b));
+            const __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 64 * b + 32));
+            nl_mask[b] = load_mask(c0, c1, '\n');
+            sp_mask[b] = load_mask(c0, c1, ' ');
+            const uint64_t ws_mask = sp_mask[b] | nl_mask[b];
+            bos_mask[b] = compute_bos_mask(nl_mask[b], ws_mask, need_bos);
+            if (carry.width == plain) {
+                markers = _mm256_or_si256(markers, _mm256_or_si256(
+                    _mm256_or_si256(_mm256_cmpeq_epi8(c0, pipe_vec), _mm256_cmpeq_epi8(c0, gt_vec)),
+                    _mm256_or_si256(_mm256_cmpeq_epi8(c1, pipe_vec), _mm256_cmpeq_epi8(c1, gt_vec))));
+            }
+        }
+
+        if (carry.width == plain) {
+            if (_mm256_movemask_epi8(markers) != 0) return false;
+            carry.need_bos = need_bos;
+            for (int b = 0; b < 4; b++) emit_events(derived(), nl_mask[b], bos_mask[b], base + 64 * b);
+            return true;
+        }
+
+        Carry next = carry;
+        uint64_t shallow = 0;
+        for (int b = 0; b < 4; b++) shallow |= shallow_bos(next, sp_mask[b], bos_mask[b]);
+        if (shallow != 0) return false;
+        carry.need_bos = need_bos;
+        carry.prev_sp = next.prev_sp;
+        for (int b = 0; b < 4; b++) emit_events(derived(), nl_mask[b], 0, base + 64 * b);
+        return true;
+    }
+
+    // Masks a block needing slow_block hands over
+    struct Masks {
+        uint64_t nl;
+        uint64_t sp;
+        uint64_t bos;
+    };
+
+    // Emits the block when no walk is needed; otherwise fills masks and
+    // returns false
+    __attribute__((always_inline, hot))
+    bool fast_block(Carry& carry, Masks& masks, const char* p, size_t base) {
+        const __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+
+        const uint64_t nl_mask = load_mask(c0, c1, '\n');
+        const uint64_t sp_mask = load_mask(c0, c1, ' ');
+        const uint64_t ws_mask = sp_mask | nl_mask;
+
+        const uint64_t bos_mask = compute_bos_mask(nl_mask, ws_mask, carry.need_bos);
+
+        if (__builtin_expect(carry.width == plain, 1)) {
+            // Whether the block has any marker byte, folded into one
+            // movemask: movemask is the scarce port here, the compares are not
+            const __m256i pipe_vec = _mm256_set1_epi8('|');
+            const __m256i gt_vec = _mm256_set1_epi8('>');
+            const uint32_t has_marker = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi8(c0, pipe_vec), _mm256_cmpeq_epi8(c0, gt_vec)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(c1, pipe_vec), _mm256_cmpeq_epi8(c1, gt_vec)))));
+            if (__builtin_expect(has_marker == 0, 1)) {
+                emit_events(derived(), nl_mask, bos_mask, base);
+                return true;
+            }
+        } else if (carry.width < slow) {
+            // Markers in block text are text, unless their line closes the
+            // block, which sends it to slow_block anyway
+            if (shallow_bos(carry, sp_mask, bos_mask) == 0) {
+                emit_events(derived(), nl_mask, 0, base);
+                return true;
+            }
+        }
+
+        carry.prev_sp = sp_mask;
+        masks = Masks{nl_mask, sp_mask, bos_mask};
+        return false;
+    }
+
+    // Blocks with a marker byte, right after one, or closing a block scalar;
+    // returns the width (mode) for the next block
+    __attribute__((noinline))
+    uint64_t slow_block(const char* p, uint64_t nl_mask, uint64_t sp_mask, uint64_t bos_mask,
+                       size_t base) {
+        // Newlines reached from a marker over spaces only
+        const uint64_t marker_mask = marker_mask_of(p);
+        const uint64_t after_marker = (marker_mask << 1) | block_.marker_top;
+        block_.marker_top = marker_mask >> 63;
+        const uint64_t marker_eol = add_with_carry(sp_mask, after_marker, block_.in_run) & ~sp_mask & nl_mask;
+
+        walk_block(nl_mask, bos_mask, marker_eol, base);
+
+        if (block_.marker_top || block_.in_run) return slow;
+        if (!block_.open) return plain;
+        return block_.owner_indent < 63 ? block_.owner_indent + 1 : slow;
+    }
+
+    // Bit by bit over bos and marker newlines, in order
+    void walk_block(uint64_t nl_mask, uint64_t bos_mask, uint64_t marker_eol, size_t base) {
+        uint64_t keep = bos_mask;
+        uint64_t pending = ~uint64_t(0);  // bits not emitted yet
+        uint64_t events = bos_mask | marker_eol;
+
+        while (events) {
+            const unsigned bit = _tzcnt_u64(events);
+            events &= events - 1;
+            const size_t pos = base + bit;
+
+            if ((marker_eol >> bit) & 1) {
+                // Markers inside a block scalar are literal text
+                if (!block_.open) {
+                    size_t owner_bos = line_start_of(nl_mask, base, bit);
+                    const size_t owner_start = owner_bos;
+                    while (data_[owner_bos] == ' ') owner_bos++;
+                    block_.open = true;
+                    block_.owner_indent = owner_bos - owner_start;
+                    block_.span_begin = pos + 1;
+                }
+                continue;
+            }
+
+            if (block_.open) {
+                const size_t line_start = line_start_of(nl_mask, base, bit);
+                if (pos - line_start > block_.owner_indent) {
+                    keep &= ~(uint64_t(1) << bit);
+                    continue;
+                }
+
+                // Dedent: report the block before the statement that closes it
+                const uint64_t before = pending & ((uint64_t(1) << bit) - 1);
+                emit_events(derived(), nl_mask & before, keep & before, base);
+                pending &= ~before;
+                derived().on_block_scalar(block_.span_begin, span_end(line_start));
+                block_.open = false;
+            }
+        }
+
+        emit_events(derived(), nl_mask & pending, keep & pending, base);
+    }
+
+    // Start of the line holding base + bit: from the block's newlines, or by
+    // scanning back when the line began in an earlier block. For a bos that
+    // scan only covers its indentation.
+    size_t line_start_of(uint64_t nl_mask, size_t base, unsigned bit) const {
+        const uint64_t nl_below = nl_mask & ((uint64_t(1) << bit) - 1);
+        if (nl_below) return base + 64 - __builtin_clzll(nl_below);
+        size_t start = base;
+        while (start > 0 && data_[start - 1] != '\n') start--;
+        return start;
+    }
+
+    // End of the open block's text before stop: the '\n' after its last
+    // non-blank byte, found by scanning back over trailing blank lines
+    size_t span_end(size_t stop) const {
+        size_t p = stop;
+        while (p > block_.span_begin && (data_[p - 1] == ' ' || data_[p - 1] == '\n')) p--;
+        if (p == block_.span_begin) return p;
+        const void* nl = std::memchr(data_ + p, '\n', stop - p);
+        return nl ? static_cast<size_t>(static_cast<const char*>(nl) - data_) : stop;
+    }
+};
+
+} // namespace yaal
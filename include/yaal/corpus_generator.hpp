@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace yaal {
+
+// How statement bodies are sized, in bytes excluding the indentation
+enum class LineLengths {
+    fixed,        // every body mean_line_length bytes (capped at max_line_length)
+    uniform,      // uniform in [1, 2 * mean_line_length - 1]
+    exponential,  // exponential with mean mean_line_length, so mostly short
+};
+
+struct CorpusShape {
+    LineLengths line_lengths = LineLengths::uniform;
+    size_t mean_line_length = 48;
+    size_t max_line_length = 256;
+    double blank_ratio = 0.05;    // lines that are empty or spaces only
+    double comment_ratio = 0.02;  // statements starting with "# "
+    double utf8_ratio = 0.0;      // words made of 2 to 4 byte UTF-8 characters
+    size_t indent_width = 2;
+    size_t max_depth = 8;
+    size_t lines_per_level = 5;   // mean run of lines at one depth
+    bool trailing_newline = true;
+};
+
+// Ground truth for a generated corpus, exact by construction
+struct CorpusCounts {
+    uint64_t bytes = 0;
+    uint64_t eol = 0;
+    uint64_t bos = 0;
+    uint64_t eos = 0;
+    uint64_t blank = 0;     // lines without a statement
+    uint64_t comments = 0;  // statements starting with "# "
+
+    CorpusCounts& operator+=(const CorpusCounts& other) {
+        bytes += other.bytes;
+        eol += other.eol;
+        bos += other.bos;
+        eos += other.eos;
+        blank += other.blank;
+        comments += other.comments;
+        return *this;
+    }
+
+    bool operator==(const CorpusCounts& other) const {
+        return bytes == other.bytes && eol == other.eol && bos == other.bos && eos == other.eos &&
+               blank == other.blank && comments == other.comments;
+    }
+
+    // Sidecar format: one "key=value" line per count
+    void write(std::ostream& out) const {
+        out << "bytes=" << bytes << "\n"
+            << "eol=" << eol << "\n"
+            << "bos=" << bos << "\n"
+            << "eos=" << eos << "\n"
+            << "blank=" << blank << "\n"
+            << "comments=" << comments << "\n";
+    }
+
+    // Reads a sidecar, ignoring keys it doesn't know; false unless the
+    // event counts were all present
+    bool read(std::istream& in) {
+        *this = CorpusCounts{};
+        int found = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            const size_t eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            const std::string key = line.substr(0, eq);
+            const uint64_t value = std::strtoull(line.c_str() + eq + 1, nullptr, 10);
+            if (key == "bytes") { bytes = value; found |= 1; }
+            else if (key == "eol") { eol = value; found |= 2; }
+            else if (key == "bos") { bos = value; found |= 4; }
+            else if (key == "eos") { eos = value; found |= 8; }
+            else if (key == "blank") blank = value;
+            else if (key == "comments") comments = value;
+        }
+        return found == 15;
+    }
+};
+
+// Synthetic YAAL corpora of a given shape, generated in parallel.
+//
+// The document is cut into segments of segment_size bytes (give or take a
+// line), each generated from its own seed derived from the corpus seed and
+// the segment index, starting at depth 0. Segments are therefore independent:
+// they are built on any number of threads and come out identical for a given
+// shape and seed. Every line is indentation copied from a run of spaces and a
+// body sliced from a pool of words built once per generator, so the cost is
+// two short chunked copies per line rather than one push_back per byte.
+//
+// Each line is counted as it is generated: one eol per '\n', and one bos and
+// one eos per line with a body. Blank lines are empty or spaces only.
+class CorpusGenerator {
+public:
+    static constexpr size_t segment_size = size_t(4) << 20;
+
+    // Words come from the dictionary when given (entries with spaces or
+    // control bytes are skipped), otherwise random lowercase words
+    explicit CorpusGenerator(const CorpusShape& shape, uint64_t seed = 42,
+                             const std::vector<std::string>& dictionary = {})
+        : shape_(shape), seed_(seed) {
+        shape_.mean_line_length = std::max<size_t>(shape_.mean_line_length, 1);
+        shape_.max_line_length = std::max<size_t>(shape_.max_line_length, 1);
+        shape_.lines_per_level = std::max<size_t>(shape_.lines_per_level, 1);
+        build_pool(dictionary);
+        spaces_.assign(shape_.indent_width * shape_.max_depth + 32, ' ');
+    }
+
+    // Generates segment index of at least size bytes into out, returning its
+    // counts. Lines are whole, so every segment ends with '\n'.
+    CorpusCounts segment(size_t index, size_t size, std::vector<char>& out) const {
+        Random rng(mix(seed_ ^ mix(index + 1)));
+        CorpusCounts counts;
+        const size_t line_room = shape_.indent_width * shape_.max_depth + shape_.max_line_length + 64;
+        out.resize(size + line_room);
+        char* const begin = out.data();
+        char* p = begin;
+        char* const end = begin + size;
+
+        size_t depth = 0;
+        while (p < end) {
+            if (rng.below(shape_.lines_per_level) == 0) {
+                // One level deeper, or back out to any enclosing level
+                if (depth < shape_.max_depth && rng.below(2) == 0) depth++;
+                else if (depth > 0) depth = rng.below(depth);
+            }
+
+            counts.eol++;
+            if (rng.chance(shape_.blank_ratio)) {
+                const size_t n = rng.below(shape_.indent_width * depth + 1);
+                copy_chunks(p, spaces_.data(), n);
+                p += n;
+                *p++ = '\n';
+                counts.blank++;
+                continue;
+            }
+
+            const size_t indent = shape_.indent_width * depth;
+            copy_chunks(p, spaces_.data(), indent);
+            p += indent;
+            size_t length = line_length(rng);
+            if (rng.chance(shape_.comment_ratio)) {
+                p[0] = '#';
+                p[1] = ' ';
+                p += 2;
+                length = length > 2 ? length - 2 : 1;
+                counts.comments++;
+            }
+            body(rng, length, p);
+            p += length;
+            *p++ = '\n';
+            counts.bos++;
+            counts.eos++;
+        }
+
+        out.resize(p - begin);
+        counts.bytes = out.size();
+        return counts;
+    }
+
+    // Generates about target_size bytes, segments built threads at a time
+    // and handed to write(const char*, size_t) in document order. Holds at
+    // most threads segments in memory.
+    template<typename Write>
+    CorpusCounts generate(size_t target_size, unsigned threads, Write&& write) const {
+        CorpusCounts total;
+        if (target_size == 0) return total;
+        threads = std::max(threads, 1u);
+
+        const size_t segments = (target_size + segment_size - 1) / segment_size;
+        std::vector<std::vector<char>> buffers(std::min<size_t>(threads, segments));
+        std::vector<CorpusCounts> counts(buffers.size());
+
+        for (size_t first = 0; first < segments; first += buffers.size()) {
+            const size_t wave = std::min(buffers.size(), segments - first);
+            auto build = [&](size_t i) {
+                const size_t index = first + i;
+                const size_t size = std::min(segment_size, target_size - index * segment_size);
+                counts[i] = segment(index, size, buffers[i]);
+            };
+
+            std::vector<std::thread> workers;
+            for (size_t i = 1; i < wave; i++) workers.emplace_back(build, i);
+            build(0);
+            for (auto& worker : workers) worker.join();
+
+            for (size_t i = 0; i < wave; i++) {
+                std::vector<char>& data = buffers[i];
+                if (!shape_.trailing_newline && first + i == segments - 1) {
+                    data.pop_back();
+                    counts[i].bytes--;
+                    counts[i].eol--;
+                    // An empty last line goes with its '\n'
+                    if (data.empty() || data.back() == '\n') counts[i].blank--;
+                }
+                write(data.data(), data.size());
+                total += counts[i];
+            }
+        }
+        return total;
+    }
+
+    // Whole corpus in memory
+    CorpusCounts generate(size_t target_size, unsigned threads, std::vector<char>& out) const {
+        out.clear();
+        out.reserve(target_size + shape_.max_line_length + shape_.indent_width * shape_.max_depth + 16);
+        return generate(target_size, threads,
+                        [&out](const char* data, size_t len) { out.insert(out.end(), data, data + len); });
+    }
+
+    const CorpusShape& shape() const { return shape_; }
+
+private:
+    // xorshift64, seeded through splitmix64
+    class Random {
+    public:
+        explicit Random(uint64_t seed) : state_(seed ? seed : 1) {}
+
+        uint64_t next() {
+            state_ ^= state_ << 13;
+            state_ ^= state_ >> 7;
+            state_ ^= state_ << 17;
+            return state_;
+        }
+
+        // Uniform in [0, n)
+        uint64_t below(uint64_t n) {
+            return static_cast<uint64_t>((static_cast<unsigned __int128>(next()) * n) >> 64);
+        }
+
+        // Uniform in [0, 1)
+        double unit() { return static_cast<double>(next() >> 11) * 0x1.0p-53; }
+
+        bool chance(double p) { return p > 0 && unit() < p; }
+
+    private:
+        uint64_t state_;
+    };
+
+    static uint64_t mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    CorpusShape shape_;
+    uint64_t seed_;
+    std::string pool_;                  // words separated by single spaces
+    std::vector<uint32_t> word_starts_; // words a body may start at
+    std::string spaces_;
+
+    size_t line_length(Random& rng) const {
+        const size_t mean = shape_.mean_line_length;
+        size_t length = mean;
+        switch (shape_.line_lengths) {
+            case LineLengths::fixed:
+                break;
+            case LineLengths::uniform:
+                length = 1 + rng.below(2 * mean - 1);
+                break;
+            case LineLengths::exponential:
+                length = 1 + static_cast<size_t>(-std::log(1.0 - rng.unit()) * static_cast<double>(mean - 1 + 0.5));
+                break;
+        }
+        return std::min(length, shape_.max_line_length);
+    }
+
+    // Copies length bytes of words to dst, starting at a word. A character
+    // cut by the end, or a space ending the body, is replaced with 'x' so
+    // the body stays valid UTF-8 without trailing spaces.
+    void body(Random& rng, size_t length, char* dst) const {
+        const char* src = pool_.data() + word_starts_[rng.below(word_starts_.size())];
+        copy_chunks(dst, src, length);
+        size_t cut = length;
+        while ((static_cast<unsigned char>(src[cut]) & 0xC0) == 0x80) cut--;
+        for (size_t i = cut; i < length; i++) dst[i] = 'x';
+        if (dst[length - 1] == ' ') dst[length - 1] = 'x';
+    }
+
+    // Copies n bytes 32 at a time: may read and write up to 31 bytes past
+    // the end, which the pool, the spaces and the segment slack allow for
+    static void copy_chunks(char* dst, const char* src, size_t n) {
+        for (size_t i = 0; i < n; i += 32) std::memcpy(dst + i, src + i, 32);
+    }
+
+    void build_pool(const std::vector<std::string>& dictionary) {
+        std::vector<const std::string*> words;
+        for (const std::string& word : dictionary) {
+            if (!word.empty() && std::none_of(word.begin(), word.end(),
+                                              [](char c) { return static_cast<unsigned char>(c) <= ' '; })) {
+                words.push_back(&word);
+            }
+        }
+
+        // Small enough to stay in cache, and long enough that any word in
+        // the first part can start a body of max_line_length bytes
+        const size_t pool_size = std::max<size_t>(size_t(1) << 17, 4 * shape_.max_line_length);
+        Random rng(mix(seed_));
+        pool_.reserve(pool_size + shape_.max_line_length + 64);
+        while (pool_.size() < pool_size + shape_.max_line_length + 16) {
+            if (!pool_.empty()) pool_.push_back(' ');
+            if (pool_.size() < pool_size) word_starts_.push_back(static_cast<uint32_t>(pool_.size()));
+            if (rng.chance(shape_.utf8_ratio)) {
+                append_utf8_word(rng);
+            } else if (!words.empty()) {
+                pool_ += *words[rng.below(words.size())];
+            } else {
+                const size_t n = 1 + rng.below(10);
+                for (size_t i = 0; i < n; i++) pool_.push_back(static_cast<char>('a' + rng.below(26)));
+            }
+        }
+        pool_.append(32, ' ');
+    }
+
+    void append_utf8_word(Random& rng) {
+        const size_t n = 1 + rng.below(6);
+        for (size_t i = 0; i < n; i++) {
+            uint32_t cp;
+            switch (rng.below(3)) {
+                case 0: cp = 0x80 + static_cast<uint32_t>(rng.below(0x800 - 0x80)); break;
+                case 1:
+                    cp = 0x800 + static_cast<uint32_t>(rng.below(0x10000 - 0x800 - 0x800));
+                    if (cp >= 0xD800) cp += 0x800;  // skip the surrogates
+                    break;
+                default: cp = 0x10000 + static_cast<uint32_t>(rng.below(0x110000 - 0x10000)); break;
+            }
+            append_code_point(cp);
+        }
+    }
+
+    void append_code_point(uint32_t cp) {
+        if (cp < 0x800) {
+            pool_.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        } else if (cp < 0x10000) {
+            pool_.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            pool_.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        } else {
+            pool_.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            pool_.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            pool_.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        }
+        pool_.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+};
+
+} // namespace yaal
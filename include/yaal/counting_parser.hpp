@@ -6,7 +6,10 @@
 
 namespace yaal {
 
-class CountingParser : public ParserBase<CountingParser> {
+// Counts events on top of any kernel taking the ParserBase callbacks, e.g.
+// BasicCountingParser<SpeculativeParserBase>
+template<template<typename> class Base>
+class BasicCountingParser : public Base<BasicCountingParser<Base>> {
 public:
     struct Counts {
         uint64_t bod = 0;
@@ -15,7 +18,7 @@ public:
         uint64_t eod = 0;
     };
 
-    CountingParser() = default;
+    BasicCountingParser() = default;
 
     // Individual event callbacks (for compatibility)
     __attribute__((always_inline)) void on_bod(size_t) { counts_.bod++; }
@@ -40,4 +43,6 @@ private:
     Counts counts_;
 };
 
+using CountingParser = BasicCountingParser<ParserBase>;
+
 } // namespace yaal
@@ -0,0 +1,331 @@
+#pragma once
+
+#include "hash.hpp"
+#include "parser_base.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace yaal {
+
+struct HashedStatement {
+    size_t begin;   // offset of the bos
+    size_t end;     // end of the value with trailing spaces trimmed
+    size_t indent;  // leading spaces
+    uint64_t hash;  // hash of the trimmed value, its length and the indentation
+};
+
+// Hashes every statement as the scan goes: the value bytes are hashed on the
+// statement's eol, while they are still in cache from the SIMD pass.
+class StatementHasher : public ParserBase<StatementHasher> {
+public:
+    StatementHasher() = default;
+
+    __attribute__((always_inline)) void on_buffer(const Buffer& buf) { data_ = buf.start(); }
+
+    __attribute__((always_inline)) void on_bod(size_t) {
+        line_start_ = 0;
+        open_ = false;
+    }
+
+    __attribute__((always_inline)) void on_bos(size_t offset) {
+        begin_ = offset;
+        open_ = true;
+    }
+
+    __attribute__((always_inline)) void on_eol(size_t offset) {
+        close(offset);
+        line_start_ = offset + 1;
+    }
+
+    __attribute__((always_inline)) void on_eod(size_t offset) { close(offset); }
+
+    const std::vector<HashedStatement>& statements() const { return statements_; }
+    std::vector<HashedStatement>& statements() { return statements_; }
+
+    void reset() { statements_.clear(); }
+
+private:
+    const char* data_ = nullptr;
+    size_t line_start_ = 0;
+    size_t begin_ = 0;
+    bool open_ = false;
+    std::vector<HashedStatement> statements_;
+
+    __attribute__((always_inline)) void close(size_t offset) {
+        if (!open_) return;
+        open_ = false;
+
+        size_t end = offset;
+        while (end > begin_ && data_[end - 1] == ' ') end--;
+
+        const size_t indent = begin_ - line_start_;
+        const uint64_t hash = hash_fold(hash_bytes(data_ + begin_, end - begin_) ^ 0x8EBC6AF09C88C6E3ULL,
+                                        indent ^ 0x589965CC75374CC3ULL);
+        statements_.push_back(HashedStatement{begin_, end, indent, hash});
+    }
+};
+
+enum class DiffKind : uint8_t {
+    added,
+    removed,
+    changed,
+};
+
+struct DiffEntry {
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    DiffKind kind;
+    size_t a_begin;  // statement span in the old document, npos when added
+    size_t a_end;
+    size_t b_begin;  // statement span in the new document, npos when removed
+    size_t b_end;
+};
+
+struct DiffOptions {
+    // Equal statements in a row after which an edit run is considered over
+    size_t resync_length = 16;
+    // Edit distance explored for one run before the rest of the range is
+    // split on statements that occur exactly once on both sides instead
+    size_t max_edit_cost = 1024;
+};
+
+// Aligns two hashed statement sequences.
+//
+// Statements compare equal when their hashes match and a byte compare of the
+// indentation and trimmed value confirms it, so a collision costs a memcmp,
+// never a wrong alignment. The aligner walks both sequences along their
+// common runs; at each mismatch it runs the forward Myers search from there
+// until a run of resync_length equal statements (or the end) is reached, and
+// keeps the shortest edit script to that point. Scattered edits in huge
+// documents therefore cost a linear walk plus a small search per edit run.
+// When a run needs more than max_edit_cost edits, the rest of the range is cut
+// at unique common statements (the patience-diff anchors), and ranges without
+// anchors are reported as wholesale replacements. Within each run, removed
+// and added statements at the same indentation are paired as changed.
+class StatementAligner {
+public:
+    StatementAligner(const char* a_data, const std::vector<HashedStatement>& a,
+                     const char* b_data, const std::vector<HashedStatement>& b, const DiffOptions& options)
+        : a_data_(a_data), b_data_(b_data), a_(a), b_(b), options_(options),
+          a_kept_(a.size(), true), b_kept_(b.size(), true) {
+        if (options_.resync_length == 0) options_.resync_length = 1;
+    }
+
+    std::vector<DiffEntry> run() {
+        align(0, a_.size(), 0, b_.size());
+        return collect();
+    }
+
+private:
+    const char* a_data_;
+    const char* b_data_;
+    const std::vector<HashedStatement>& a_;
+    const std::vector<HashedStatement>& b_;
+    DiffOptions options_;
+    std::vector<bool> a_kept_;
+    std::vector<bool> b_kept_;
+    std::vector<ptrdiff_t> trace_;  // furthest x per diagonal, one row per edit cost
+
+    bool same(const HashedStatement& x, const HashedStatement& y) const {
+        return x.hash == y.hash && x.indent == y.indent && x.end - x.begin == y.end - y.begin &&
+               std::memcmp(a_data_ + x.begin, b_data_ + y.begin, x.end - x.begin) == 0;
+    }
+
+    void replace(size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi) {
+        for (size_t i = a_lo; i < a_hi; i++) a_kept_[i] = false;
+        for (size_t j = b_lo; j < b_hi; j++) b_kept_[j] = false;
+    }
+
+    void align(size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi) {
+        size_t i = a_lo, j = b_lo;
+        for (;;) {
+            while (i < a_hi && j < b_hi && same(a_[i], b_[j])) {
+                i++;
+                j++;
+            }
+            if (i == a_hi || j == b_hi) {
+                replace(i, a_hi, j, b_hi);
+                return;
+            }
+            if (!resync(i, j, a_hi, b_hi)) {
+                if (!split_on_anchors(i, a_hi, j, b_hi)) replace(i, a_hi, j, b_hi);
+                return;
+            }
+        }
+    }
+
+    // Forward Myers search from (i, j), which mismatch. Marks the shortest
+    // edit script up to the first snake of resync_length statements (or the
+    // end of both ranges) and advances (i, j) to that snake's start. Returns
+    // false when max_edit_cost edits are not enough.
+    bool resync(size_t& i, size_t& j, size_t a_hi, size_t b_hi) {
+        const ptrdiff_t n = static_cast<ptrdiff_t>(a_hi - i);
+        const ptrdiff_t m = static_cast<ptrdiff_t>(b_hi - j);
+        const ptrdiff_t max_d = std::min<ptrdiff_t>(n + m, static_cast<ptrdiff_t>(options_.max_edit_cost));
+        const ptrdiff_t sync = static_cast<ptrdiff_t>(options_.resync_length);
+        const ptrdiff_t width = 2 * max_d + 3;
+        const ptrdiff_t off = max_d + 1;
+        const HashedStatement* sa = a_.data() + i;
+        const HashedStatement* sb = b_.data() + j;
+
+        // Row d + 1 holds the furthest x per diagonal at cost d; row 0 is
+        // the all-zero start row
+        trace_.assign(static_cast<size_t>(width), 0);
+
+        for (ptrdiff_t d = 0; d <= max_d; d++) {
+            trace_.resize(static_cast<size_t>(width * (d + 2)));
+            const ptrdiff_t* prev = trace_.data() + width * d;
+            ptrdiff_t* row = trace_.data() + width * (d + 1);
+
+            for (ptrdiff_t k = -d; k <= d; k += 2) {
+                ptrdiff_t x = (k == -d || (k != d && prev[off + k - 1] < prev[off + k + 1]))
+                    ? prev[off + k + 1] : prev[off + k - 1] + 1;
+                ptrdiff_t y = x - k;
+                const ptrdiff_t x0 = x;
+                while (x < n && y < m && same(sa[x], sb[y])) {
+                    x++;
+                    y++;
+                }
+                row[off + k] = x;
+
+                if (x - x0 >= sync || (x == n && y == m)) {
+                    mark_path(i, j, d, k, width, off);
+                    i += static_cast<size_t>(x0);
+                    j += static_cast<size_t>(x0 - k);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Walks the trace back from diagonal k at cost d, marking each edit
+    void mark_path(size_t i, size_t j, ptrdiff_t d, ptrdiff_t k, ptrdiff_t width, ptrdiff_t off) {
+        for (; d > 0; d--) {
+            const ptrdiff_t* prev = trace_.data() + width * d;
+            const bool down = k == -d || (k != d && prev[off + k - 1] < prev[off + k + 1]);
+            const ptrdiff_t prev_k = down ? k + 1 : k - 1;
+            const ptrdiff_t prev_x = prev[off + prev_k];
+            const ptrdiff_t prev_y = prev_x - prev_k;
+            if (down) {
+                b_kept_[j + static_cast<size_t>(prev_y)] = false;
+            } else {
+                a_kept_[i + static_cast<size_t>(prev_x)] = false;
+            }
+            k = prev_k;
+        }
+    }
+
+    // Cuts the range at statements unique on both sides, keeping the longest
+    // run of them that appears in the same order (patience diff)
+    bool split_on_anchors(size_t a_lo, size_t a_hi, size_t b_lo, size_t b_hi) {
+        auto unique_keys = [](const std::vector<HashedStatement>& s, size_t lo, size_t hi) {
+            std::vector<std::pair<uint64_t, size_t>> sorted;
+            sorted.reserve(hi - lo);
+            for (size_t i = lo; i < hi; i++) sorted.emplace_back(s[i].hash, i);
+            std::sort(sorted.begin(), sorted.end());
+            std::vector<std::pair<uint64_t, size_t>> unique;
+            for (size_t i = 0; i < sorted.size(); i++) {
+                bool dup = (i > 0 && sorted[i - 1].first == sorted[i].first) ||
+                           (i + 1 < sorted.size() && sorted[i + 1].first == sorted[i].first);
+                if (!dup) unique.push_back(sorted[i]);
+            }
+            return unique;
+        };
+
+        auto ua = unique_keys(a_, a_lo, a_hi);
+        auto ub = unique_keys(b_, b_lo, b_hi);
+
+        std::vector<std::pair<size_t, size_t>> pairs;  // (a index, b index)
+        for (size_t i = 0, j = 0; i < ua.size() && j < ub.size();) {
+            if (ua[i].first < ub[j].first) {
+                i++;
+            } else if (ub[j].first < ua[i].first) {
+                j++;
+            } else {
+                if (same(a_[ua[i].second], b_[ub[j].second])) pairs.emplace_back(ua[i].second, ub[j].second);
+                i++;
+                j++;
+            }
+        }
+        if (pairs.empty()) return false;
+        std::sort(pairs.begin(), pairs.end());
+
+        // Longest increasing subsequence of b indices
+        std::vector<size_t> tails;  // index into pairs of the smallest tail per length
+        std::vector<size_t> prev(pairs.size(), static_cast<size_t>(-1));
+        for (size_t i = 0; i < pairs.size(); i++) {
+            auto it = std::lower_bound(tails.begin(), tails.end(), pairs[i].second,
+                                       [&](size_t t, size_t b) { return pairs[t].second < b; });
+            if (it != tails.begin()) prev[i] = *(it - 1);
+            if (it == tails.end()) tails.push_back(i);
+            else *it = i;
+        }
+
+        std::vector<std::pair<size_t, size_t>> anchors;
+        for (size_t i = tails.back(); i != static_cast<size_t>(-1); i = prev[i]) anchors.push_back(pairs[i]);
+        std::reverse(anchors.begin(), anchors.end());
+
+        size_t ai = a_lo, bi = b_lo;
+        for (const auto& anchor : anchors) {
+            align(ai, anchor.first, bi, anchor.second);
+            ai = anchor.first + 1;
+            bi = anchor.second + 1;
+        }
+        align(ai, a_hi, bi, b_hi);
+        return true;
+    }
+
+    std::vector<DiffEntry> collect() const {
+        constexpr size_t npos = DiffEntry::npos;
+        std::vector<DiffEntry> out;
+        size_t i = 0, j = 0;
+        while (i < a_.size() || j < b_.size()) {
+            if (i < a_.size() && j < b_.size() && a_kept_[i] && b_kept_[j]) {
+                i++;
+                j++;
+                continue;
+            }
+
+            size_t i_end = i, j_end = j;
+            while (i_end < a_.size() && !a_kept_[i_end]) i_end++;
+            while (j_end < b_.size() && !b_kept_[j_end]) j_end++;
+
+            while (i < i_end || j < j_end) {
+                if (i < i_end && j < j_end && a_[i].indent == b_[j].indent) {
+                    out.push_back(DiffEntry{DiffKind::changed, a_[i].begin, a_[i].end, b_[j].begin, b_[j].end});
+                    i++;
+                    j++;
+                } else if (i < i_end && (j == j_end || a_[i].indent > b_[j].indent)) {
+                    out.push_back(DiffEntry{DiffKind::removed, a_[i].begin, a_[i].end, npos, npos});
+                    i++;
+                } else {
+                    out.push_back(DiffEntry{DiffKind::added, npos, npos, b_[j].begin, b_[j].end});
+                    j++;
+                }
+            }
+        }
+        return out;
+    }
+};
+
+// Structural diff of two documents: added, removed and changed statements
+// with their offsets, in document order. Both documents are hashed in
+// parallel.
+inline std::vector<DiffEntry> diff(const Buffer& a, const Buffer& b, const DiffOptions& options = {}) {
+    StatementHasher hash_a;
+    StatementHasher hash_b;
+
+    std::thread worker([&] { hash_a.parse(a); });
+    hash_b.parse(b);
+    worker.join();
+
+    return StatementAligner(a.start(), hash_a.statements(), b.start(), hash_b.statements(), options).run();
+}
+
+} // namespace yaal
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "parser_base.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace yaal {
+
+enum class EventKind : uint8_t {
+    bod,
+    bos,
+    eol,
+    eod,
+};
+
+// One event in 8 bytes: the kind in the top two bits, the offset below, so
+// a batch carries no padding
+struct Event {
+    static constexpr int kind_shift = 62;
+    static constexpr uint64_t offset_mask = (uint64_t(1) << kind_shift) - 1;
+
+    uint64_t bits;
+
+    Event() = default;
+    Event(EventKind kind, uint64_t offset)
+        : bits((static_cast<uint64_t>(kind) << kind_shift) | offset) {}
+
+    uint64_t offset() const { return bits & offset_mask; }
+    EventKind kind() const { return static_cast<EventKind>(bits >> kind_shift); }
+};
+
+static_assert(sizeof(Event) == 8, "Event must pack into one word");
+
+// Runtime-polymorphic event consumer for plugins and language bindings.
+//
+// Events arrive in arrays, in the order the parser emitted them, so the
+// indirect call is paid once per batch instead of once per event. The array
+// is only valid for the duration of the call.
+class EventSink {
+public:
+    virtual ~EventSink() = default;
+
+    virtual void on_events(const Event* events, size_t count) = 0;
+};
+
+// CRTP adapter that buffers ParserBase events into fixed-size arrays and
+// hands them to an EventSink. The final partial batch is delivered on eod.
+template<size_t BatchSize = 1024>
+class BufferedSinkParser : public ParserBase<BufferedSinkParser<BatchSize>> {
+    static_assert(BatchSize > 0, "BatchSize must be non-zero");
+
+public:
+    explicit BufferedSinkParser(EventSink& sink) : sink_(&sink) {}
+
+    __attribute__((always_inline)) void on_bod(size_t offset) { push(EventKind::bod, offset); }
+    __attribute__((always_inline)) void on_bos(size_t offset) { push(EventKind::bos, offset); }
+    __attribute__((always_inline)) void on_eol(size_t offset) { push(EventKind::eol, offset); }
+
+    void on_eod(size_t offset) {
+        push(EventKind::eod, offset);
+        flush();
+    }
+
+    // Delivers any buffered events to the sink
+    void flush() {
+        if (count_ > 0) {
+            sink_->on_events(events_.data(), count_);
+            count_ = 0;
+        }
+    }
+
+    void reset() { count_ = 0; }
+
+private:
+    EventSink* sink_;
+    size_t count_ = 0;
+    std::array<Event, BatchSize> events_;
+
+    __attribute__((always_inline))
+    void push(EventKind kind, size_t offset) {
+        events_[count_++] = Event(kind, offset);
+        if (__builtin_expect(count_ == BatchSize, 0)) {
+            flush();
+        }
+    }
+};
+
+} // namespace yaal
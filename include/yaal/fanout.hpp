@@ -0,0 +1,109 @@
+#pragma once
+
+#include "parser_base.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace yaal {
+
+// SFINAE helper to detect a handler that hides its kernel's parse() with
+// its own, which a Fanout would never call
+template<typename T, typename = void>
+struct hides_parse : std::false_type {};
+
+template<typename T>
+struct hides_parse<T, std::void_t<decltype(&T::parse)>>
+    : std::is_same<decltype(&T::parse), void (T::*)(const Buffer&)> {};
+
+// Runs several handlers off a single ParserBase scan.
+//
+// Each handler only needs the on_bod/on_bos/on_eol/on_eod callbacks (and,
+// optionally, supports_batch with on_eol_batch/on_bos_batch, or
+// on_buffer(const Buffer&) to read the bytes), so existing parsers such as
+// CountingParser or PathQuery can be plugged in directly. Events are
+// forwarded to every handler in declaration order, unrolled at compile time.
+// The batch fast path is only taken when all handlers support it; otherwise
+// every handler receives the per-event callbacks. When every handler has a
+// mask filter, each block goes to each handler through its own filter and
+// batch support, so every handler sees what it would see scanning alone.
+template<typename... Handlers>
+class Fanout : public ParserBase<Fanout<Handlers...>> {
+    static_assert(sizeof...(Handlers) > 0, "Fanout needs at least one handler");
+    static_assert(!(hides_parse<Handlers>::value || ...),
+                  "Fanout never calls a handler's own parse(); take the buffer in on_buffer(const Buffer&)");
+
+public:
+    Fanout() = default;
+    explicit Fanout(Handlers... handlers) : handlers_(std::move(handlers)...) {}
+
+    // Hands the buffer to the handlers that read it
+    __attribute__((always_inline)) void on_buffer(const Buffer& buf) {
+        for_each([&buf](auto& h) {
+            if constexpr (has_buffer_hook<std::decay_t<decltype(h)>>::value) h.on_buffer(buf);
+        });
+    }
+
+    __attribute__((always_inline)) void on_bod(size_t offset) {
+        for_each([offset](auto& h) { h.on_bod(offset); });
+    }
+    __attribute__((always_inline)) void on_bos(size_t offset) {
+        for_each([offset](auto& h) { h.on_bos(offset); });
+    }
+    __attribute__((always_inline)) void on_eol(size_t offset) {
+        for_each([offset](auto& h) { h.on_eol(offset); });
+    }
+    __attribute__((always_inline)) void on_eod(size_t offset) {
+        for_each([offset](auto& h) { h.on_eod(offset); });
+    }
+
+    // Batch callbacks - only used when every handler supports them
+    static constexpr bool supports_batch = (has_batch_support<Handlers>::value && ...);
+
+    __attribute__((always_inline)) void on_eol_batch(uint64_t count) {
+        for_each([count](auto& h) { h.on_eol_batch(count); });
+    }
+    __attribute__((always_inline)) void on_bos_batch(uint64_t count) {
+        for_each([count](auto& h) { h.on_bos_batch(count); });
+    }
+
+    // Mask filters - only used when every handler has one. The block is
+    // emitted to each handler here, leaving nothing for the kernel to emit.
+    static constexpr bool supports_event_filter = (has_event_filter<Handlers>::value && ...);
+
+    __attribute__((always_inline))
+    void filter_events(uint64_t& nl_mask, uint64_t& bos_mask, size_t base_pos) {
+        const uint64_t nl = nl_mask, bos = bos_mask;
+        for_each([nl, bos, base_pos](auto& h) { emit_events(h, nl, bos, base_pos); });
+        nl_mask = 0;
+        bos_mask = 0;
+    }
+
+    template<size_t I>
+    auto& get() { return std::get<I>(handlers_); }
+
+    template<size_t I>
+    const auto& get() const { return std::get<I>(handlers_); }
+
+    template<typename Handler>
+    Handler& get() { return std::get<Handler>(handlers_); }
+
+    template<typename Handler>
+    const Handler& get() const { return std::get<Handler>(handlers_); }
+
+    void reset() {
+        for_each([](auto& h) { h.reset(); });
+    }
+
+private:
+    std::tuple<Handlers...> handlers_;
+
+    template<typename F>
+    __attribute__((always_inline)) void for_each(F&& f) {
+        std::apply([&f](auto&... h) { (f(h), ...); }, handlers_);
+    }
+};
+
+} // namespace yaal
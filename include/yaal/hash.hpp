@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace yaal {
+
+// Folds a 64x64->128 multiply back to 64 bits
+inline uint64_t hash_fold(uint64_t a, uint64_t b) {
+    __uint128_t r = static_cast<__uint128_t>(a) * b;
+    return static_cast<uint64_t>(r) ^ static_cast<uint64_t>(r >> 64);
+}
+
+// 16 bytes per multiply, in the style of wyhash. Tails are read with
+// overlapping fixed-size loads so no variable memcpy is needed.
+inline uint64_t hash_bytes(const char* p, size_t n) {
+    auto read64 = [](const char* q) {
+        uint64_t v;
+        std::memcpy(&v, q, 8);
+        return v;
+    };
+    auto read32 = [](const char* q) {
+        uint32_t v;
+        std::memcpy(&v, q, 4);
+        return static_cast<uint64_t>(v);
+    };
+
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n;
+    uint64_t w0 = 0, w1 = 0;
+    if (n > 16) {
+        const char* last = p + n - 16;
+        while (p < last) {
+            h = hash_fold(read64(p) ^ 0xA0761D6478BD642FULL, read64(p + 8) ^ h);
+            p += 16;
+        }
+        w0 = read64(last);
+        w1 = read64(last + 8);
+    } else if (n >= 8) {
+        w0 = read64(p);
+        w1 = read64(p + n - 8);
+    } else if (n >= 4) {
+        w0 = read32(p);
+        w1 = read32(p + n - 4);
+    } else if (n > 0) {
+        w0 = (static_cast<uint64_t>(static_cast<uint8_t>(p[0])) << 16) |
+             (static_cast<uint64_t>(static_cast<uint8_t>(p[n >> 1])) << 8) |
+             static_cast<uint8_t>(p[n - 1]);
+    }
+    return hash_fold(w0 ^ 0xE7037ED1A0B428DBULL, w1 ^ h);
+}
+
+} // namespace yaal
@@ -0,0 +1,477 @@
+#pragma once
+
+#include "hash.hpp"
+#include "parser_base.hpp"
+#include "writer.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <vector>
+
+namespace yaal {
+
+struct JsonOptions {
+    // Count keys repeated within one object in duplicate_keys(). This keeps
+    // the keys of every open object, so memory and time grow with objects
+    // that stay open long, the root above all
+    bool count_duplicate_keys = false;
+};
+
+// Streaming YAAL to JSON conversion, straight from the parser events.
+//
+// Nesting is taken from the indentation as in PathQuery: a statement's
+// children are the following statements indented deeper. Each run of
+// sibling statements becomes one JSON container:
+//  - an array when the first sibling is a list item ("- value" or "-"),
+//    whose items become the elements ("value", or null for a bare "-");
+//  - otherwise an object, whose statements become members: "key: value"
+//    splits at the first ": " (or a trailing ':'), text without one is a
+//    key with a null value.
+// A statement with children has the children's container as its value;
+// as in YAML it cannot also carry an inline value, which is dropped and
+// counted in dropped_values(). A key already present in its object is
+// written again, and JSON parsers differ on which copy wins; with
+// count_duplicate_keys set it is counted in duplicate_keys(). Both are zero
+// when the JSON holds every statement exactly. Statements that don't fit
+// their container (a non-item in an array) are kept whole as a string
+// element. Scalars are emitted as JSON strings and trailing spaces are
+// trimmed. An empty document becomes {}.
+//
+// A statement is only written once the next one shows whether it has
+// children, so memory is one pending statement plus the open containers,
+// and their keys when duplicates are counted.
+// Output is compact JSON, assembled in a buffer that is either handed to
+// an OutputSink whenever it fills, or grown to hold the whole result.
+// String bodies are scanned 32 bytes at a time for '"', '\\' and control
+// bytes; runs without them are copied whole.
+class JsonTranscoder : public ParserBase<JsonTranscoder> {
+public:
+    static constexpr size_t default_buffer_size = size_t(1) << 20;
+
+    // Output accumulates in a growable buffer, see output()
+    explicit JsonTranscoder(const JsonOptions& options = {})
+        : buffer_(initial_capacity + slack), options_(options) {}
+
+    // Output is handed to sink in chunks of up to buffer_size bytes
+    explicit JsonTranscoder(OutputSink& sink, size_t buffer_size = default_buffer_size,
+                            const JsonOptions& options = {})
+        : sink_(&sink), buffer_(std::max(buffer_size, initial_capacity) + slack), options_(options) {}
+
+    __attribute__((always_inline)) void on_buffer(const Buffer& buf) { data_ = buf.start(); }
+
+    __attribute__((always_inline)) void on_bod(size_t) {
+        line_start_ = 0;
+        open_ = false;
+        pending_ = false;
+        containers_.clear();
+        keys_.clear();
+        dropped_values_ = 0;
+        duplicate_keys_ = 0;
+    }
+
+    __attribute__((always_inline)) void on_bos(size_t offset) {
+        bos_ = offset;
+        open_ = true;
+    }
+
+    __attribute__((always_inline)) void on_eol(size_t offset) {
+        if (open_) statement(offset);
+        line_start_ = offset + 1;
+    }
+
+    void on_eod(size_t offset) {
+        if (open_) statement(offset);
+        if (pending_) {
+            write_pending(true);
+            close_containers(0);
+            put_char(containers_.back().array ? ']' : '}');
+            keys_.release(containers_.back().key_mark);
+            containers_.pop_back();
+        } else {
+            put_raw("{}", 2);
+        }
+        if (sink_) flush();
+    }
+
+    // Hands buffered output to the sink (sink mode only)
+    void flush() {
+        if (used_ > 0) {
+            sink_->write(buffer_.data(), used_);
+            written_ += used_;
+            used_ = 0;
+        }
+    }
+
+    // The JSON text so far (growable mode)
+    const char* output() const { return buffer_.data(); }
+    size_t output_size() const { return used_; }
+
+    // Bytes of JSON produced so far, in either mode
+    uint64_t bytes_written() const { return written_ + used_; }
+
+    // Inline values of statements with children, left out of the JSON
+    uint64_t dropped_values() const { return dropped_values_; }
+    // Keys written again into an object that already has them; zero unless
+    // count_duplicate_keys is set
+    uint64_t duplicate_keys() const { return duplicate_keys_; }
+
+    // Heap held by the transcoder: output buffer, container stack and keys
+    size_t memory_footprint() const {
+        return buffer_.capacity() + containers_.capacity() * sizeof(Container) + keys_.memory_footprint();
+    }
+
+    void reset() {
+        used_ = 0;
+        written_ = 0;
+    }
+
+private:
+    static constexpr size_t initial_capacity = 4096;
+    // Room for one escaped 32-byte chunk ("\u00XX" per byte) plus punctuation
+    static constexpr size_t chunk_room = 32 * 6 + 16;
+    static constexpr size_t slack = 64;
+
+    struct Container {
+        size_t parent_indent;  // indentation of the owning statement
+        uint64_t id;
+        size_t key_mark;       // keys inserted before the container opened
+        bool array;
+        bool empty;
+    };
+
+    // Keys of the open objects. Entries form a stack, since objects close
+    // innermost first: closing one truncates it to the object's mark, and
+    // while a key goes in, its object's keys are the top of the stack. Small
+    // objects are scanned there; past scan_limit keys an object is also
+    // indexed in an open-addressed table of 8-byte slots, a hash tag and an
+    // entry number. The table is not cleared on close; a stale slot leads to
+    // a live entry or none, and the entry itself is compared, so lookups stay
+    // exact. Stale slots go when the table is rebuilt from the stack.
+    class KeySet {
+    public:
+        // False when the object, whose keys start at mark, already holds the
+        // key. Kept out of line so the transcoder without it stays as fast
+        __attribute__((noinline))
+        bool insert(uint64_t object, size_t mark, const char* key, size_t len) {
+            const size_t live = entries_.size() - mark;
+            if (live < scan_limit) {
+                for (size_t n = mark; n < entries_.size(); n++) {
+                    const Entry& e = entries_[n];
+                    if (e.len == len && std::memcmp(e.key, key, len) == 0) return false;
+                }
+                entries_.push_back(Entry{0, object, key, len});
+                return true;
+            }
+            if (live == scan_limit) {
+                for (size_t n = mark; n < entries_.size(); n++) index(n);
+            }
+            if ((occupied_ + 1) * 4 > slots_.size() * 3) rehash();
+            const uint64_t hash = hash_bytes(key, len) | 1;
+            const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+            const size_t mask = slots_.size() - 1;
+            size_t i = hash & mask;
+            for (; slots_[i].entry != empty; i = (i + 1) & mask) {
+                const Slot s = slots_[i];
+                if (s.tag != tag || s.entry >= entries_.size()) continue;
+                const Entry& e = entries_[s.entry];
+                if (e.object == object && e.hash == hash && e.len == len && std::memcmp(e.key, key, len) == 0) {
+                    return false;
+                }
+            }
+            slots_[i] = Slot{tag, static_cast<uint32_t>(entries_.size())};
+            occupied_++;
+            entries_.push_back(Entry{hash, object, key, len});
+            return true;
+        }
+
+        size_t mark() const { return entries_.size(); }
+
+        // Forgets the keys inserted since mark
+        void release(size_t mark) { entries_.resize(mark); }
+
+        void clear() {
+            slots_.assign(slots_.size(), Slot{});
+            entries_.clear();
+            occupied_ = 0;
+        }
+
+        size_t memory_footprint() const {
+            return slots_.capacity() * sizeof(Slot) + entries_.capacity() * sizeof(Entry);
+        }
+
+    private:
+        static constexpr size_t scan_limit = 8;
+        static constexpr uint32_t empty = ~uint32_t(0);
+
+        struct Slot {
+            uint32_t tag = 0;
+            uint32_t entry = empty;
+        };
+
+        struct Entry {
+            uint64_t hash;  // 0 while not indexed
+            uint64_t object;
+            const char* key;
+            size_t len;
+        };
+
+        std::vector<Slot> slots_;
+        std::vector<Entry> entries_;
+        size_t occupied_ = 0;  // slots in use, stale ones included
+
+        void index(size_t n) {
+            if ((occupied_ + 1) * 4 > slots_.size() * 3) rehash();
+            Entry& e = entries_[n];
+            if (e.hash == 0) e.hash = hash_bytes(e.key, e.len) | 1;
+            put(e.hash, n);
+            occupied_++;
+        }
+
+        void put(uint64_t hash, size_t n) {
+            const size_t mask = slots_.size() - 1;
+            size_t i = hash & mask;
+            while (slots_[i].entry != empty) i = (i + 1) & mask;
+            slots_[i] = Slot{static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(n)};
+        }
+
+        // Rebuilds from the indexed entries at half load at most
+        void rehash() {
+            size_t live = 0;
+            for (const Entry& e : entries_) live += e.hash != 0;
+            size_t size = 16;
+            while (size < live * 2 + 2) size *= 2;
+            slots_.assign(size, Slot{});
+            occupied_ = live;
+            for (size_t n = 0; n < entries_.size(); n++) {
+                if (entries_[n].hash != 0) put(entries_[n].hash, n);
+            }
+        }
+    };
+
+    OutputSink* sink_ = nullptr;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    uint64_t written_ = 0;
+
+    const char* data_ = nullptr;
+    std::vector<Container> containers_;  // root first, closed only at eod
+    uint64_t next_id_ = 1;
+    JsonOptions options_;
+    KeySet keys_;
+    uint64_t dropped_values_ = 0;
+    uint64_t duplicate_keys_ = 0;
+    size_t line_start_ = 0;
+    size_t bos_ = 0;
+    bool open_ = false;
+
+    // The last statement, written once the next one arrives
+    bool pending_ = false;
+    size_t pending_begin_ = 0;
+    size_t pending_end_ = 0;
+    size_t pending_indent_ = 0;
+
+    __attribute__((always_inline))
+    void statement(size_t eol) {
+        open_ = false;
+        size_t end = eol;
+        while (data_[end - 1] == ' ') end--;
+        const size_t indent = bos_ - line_start_;
+
+        if (!pending_) {
+            open_container(0, is_item(bos_, end));
+        } else if (indent > pending_indent_) {
+            write_pending(false);
+            open_container(pending_indent_, is_item(bos_, end));
+        } else {
+            write_pending(true);
+            close_containers(indent);
+        }
+
+        pending_ = true;
+        pending_begin_ = bos_;
+        pending_end_ = end;
+        pending_indent_ = indent;
+    }
+
+    static bool is_item_text(const char* p, size_t n) {
+        return p[0] == '-' && (n == 1 || p[1] == ' ');
+    }
+
+    bool is_item(size_t begin, size_t end) const { return is_item_text(data_ + begin, end - begin); }
+
+    void open_container(size_t parent_indent, bool array) {
+        put_char(array ? '[' : '{');
+        containers_.push_back(Container{parent_indent, next_id_++, keys_.mark(), array, true});
+    }
+
+    // Closes the containers owned by statements indented at least indent,
+    // leaving the root
+    void close_containers(size_t indent) {
+        while (containers_.size() > 1 && containers_.back().parent_indent >= indent) {
+            put_char(containers_.back().array ? ']' : '}');
+            keys_.release(containers_.back().key_mark);
+            containers_.pop_back();
+        }
+    }
+
+    // Writes the pending statement into the current container. A leaf gets
+    // its value; otherwise only the key (or the comma of an array slot) is
+    // written, and the children's container follows: any inline value, or
+    // the whole text of a non-item in an array, is dropped.
+    void write_pending(bool leaf) {
+        Container& c = containers_.back();
+        if (!c.empty) put_char(',');
+        c.empty = false;
+
+        const char* p = data_ + pending_begin_;
+        const size_t n = pending_end_ - pending_begin_;
+
+        if (c.array) {
+            if (!is_item_text(p, n)) {
+                if (leaf) put_string(p, n);
+                else dropped_values_++;
+                return;
+            }
+            size_t skip = 1;
+            while (skip < n && p[skip] == ' ') skip++;
+            if (!leaf) {
+                dropped_values_ += skip != n;
+                return;
+            }
+            if (skip == n) put_raw("null", 4);
+            else put_string(p + skip, n - skip);
+            return;
+        }
+
+        size_t key_end = n;
+        size_t value_begin = n;
+        const char* colon = p;
+        while ((colon = static_cast<const char*>(std::memchr(colon, ':', n - (colon - p)))) != nullptr) {
+            const size_t at = colon - p;
+            if (at + 1 == n || p[at + 1] == ' ') {
+                key_end = at;
+                value_begin = at + 1;
+                while (key_end > 0 && p[key_end - 1] == ' ') key_end--;
+                while (value_begin < n && p[value_begin] == ' ') value_begin++;
+                break;
+            }
+            colon++;
+        }
+
+        if (options_.count_duplicate_keys && !keys_.insert(c.id, c.key_mark, p, key_end)) duplicate_keys_++;
+        put_string(p, key_end);
+        put_char(':');
+        if (!leaf) {
+            dropped_values_ += value_begin != n;
+            return;
+        }
+        if (value_begin == n) put_raw("null", 4);
+        else put_string(p + value_begin, n - value_begin);
+    }
+
+    // Makes room for n more bytes: flushes to the sink or grows the buffer
+    __attribute__((always_inline))
+    void reserve(size_t n) {
+        const size_t capacity = buffer_.size() - slack;
+        if (__builtin_expect(n > capacity - used_, 0)) {
+            if (sink_) {
+                flush();
+            } else {
+                buffer_.resize(std::max(capacity * 2, used_ + n) + slack);
+            }
+        }
+    }
+
+    __attribute__((always_inline))
+    void put_char(char c) {
+        reserve(1);
+        buffer_[used_++] = c;
+    }
+
+    void put_raw(const char* p, size_t n) {
+        reserve(n);
+        std::memcpy(buffer_.data() + used_, p, n);
+        used_ += n;
+    }
+
+    // Bytes that need escaping in a JSON string: '"', '\\' and below 0x20
+    __attribute__((always_inline))
+    static uint32_t escape_mask(__m256i c) {
+        const __m256i special = _mm256_or_si256(
+            _mm256_cmpeq_epi8(c, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\\')));
+        const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(c, _mm256_set1_epi8(0x1F)), c);
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(special, control)));
+    }
+
+    void put_string(const char* p, size_t n) {
+        reserve(chunk_room);
+        buffer_[used_++] = '"';
+
+        alignas(32) char tail[32];
+        while (n > 0) {
+            __m256i chunk;
+            size_t avail = 32;
+            if (n >= 32) {
+                chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            } else {
+                // Padded with a byte that never needs escaping
+                std::memset(tail, 'a', sizeof(tail));
+                std::memcpy(tail, p, n);
+                chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+                avail = n;
+            }
+
+            reserve(chunk_room);
+            char* dst = buffer_.data() + used_;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), chunk);
+            uint32_t mask = escape_mask(chunk);
+            if (__builtin_expect(mask == 0, 1)) {
+                used_ += avail;
+                p += avail;
+                n -= avail;
+                continue;
+            }
+
+            // Copy up to each escaped byte, then its escape
+            size_t done = 0;
+            while (mask) {
+                const size_t at = _tzcnt_u32(mask);
+                std::memcpy(dst, p + done, at - done);
+                dst += at - done;
+                dst += write_escape(dst, static_cast<unsigned char>(p[at]));
+                done = at + 1;
+                mask &= mask - 1;
+            }
+            std::memcpy(dst, p + done, avail - done);
+            dst += avail - done;
+            used_ = dst - buffer_.data();
+            p += avail;
+            n -= avail;
+        }
+
+        buffer_[used_++] = '"';
+    }
+
+    static size_t write_escape(char* dst, unsigned char c) {
+        static const char hex[] = "0123456789abcdef";
+        dst[0] = '\\';
+        switch (c) {
+            case '"': dst[1] = '"'; return 2;
+            case '\\': dst[1] = '\\'; return 2;
+            case '\b': dst[1] = 'b'; return 2;
+            case '\f': dst[1] = 'f'; return 2;
+            case '\n': dst[1] = 'n'; return 2;
+            case '\r': dst[1] = 'r'; return 2;
+            case '\t': dst[1] = 't'; return 2;
+            default:
+                std::memcpy(dst + 1, "u00", 3);
+                dst[4] = hex[c >> 4];
+                dst[5] = hex[c & 0xF];
+                return 6;
+        }
+    }
+};
+
+} // namespace yaal
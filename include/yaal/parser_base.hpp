@@ -5,9 +5,99 @@
 #include <cstdint>
 #include <immintrin.h>
 #include <type_traits>
+#include <utility>
 
 namespace yaal {
 
+// SFINAE helper to detect batch support
+template<typename T, typename = void>
+struct has_batch_support : std::false_type {};
+
+template<typename T>
+struct has_batch_support<T, std::void_t<decltype(T::supports_batch)>>
+    : std::bool_constant<T::supports_batch> {};
+
+// SFINAE helper to detect a mask filter: a consumer declaring
+// supports_event_filter gets filter_events(nl_mask, bos_mask, base_pos)
+// called on each 64- or 32-byte block before its events are emitted, and
+// may clear bits of events it has no use for
+template<typename T, typename = void>
+struct has_event_filter : std::false_type {};
+
+template<typename T>
+struct has_event_filter<T, std::void_t<decltype(T::supports_event_filter)>>
+    : std::bool_constant<T::supports_event_filter> {};
+
+// SFINAE helper to detect a buffer hook: a consumer that reads the bytes
+// behind its events declares on_buffer(const Buffer&), which every kernel
+// calls before on_bod. Fanout forwards it, so such consumers never need to
+// wrap parse().
+template<typename T, typename = void>
+struct has_buffer_hook : std::false_type {};
+
+template<typename T>
+struct has_buffer_hook<T, std::void_t<decltype(std::declval<T&>().on_buffer(std::declval<const Buffer&>()))>>
+    : std::true_type {};
+
+// Kernel pieces shared by ParserBase and the kernels built on its masks
+
+// Starts a document: the buffer hook when derived has one, then on_bod
+template<typename Derived>
+__attribute__((always_inline))
+inline void begin_document(Derived& derived, const Buffer& buf) {
+    if constexpr (has_buffer_hook<Derived>::value) {
+        derived.on_buffer(buf);
+    }
+    derived.on_bod(0);
+}
+
+// Bit i set when byte i of the 64 bytes in c0 (low half) and c1 equals value
+__attribute__((always_inline))
+inline uint64_t load_mask(__m256i c0, __m256i c1, char value) {
+    const __m256i vec = _mm256_set1_epi8(value);
+    return (static_cast<uint64_t>(static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, vec)))) << 32) |
+        static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c0, vec)));
+}
+
+// Bos bits of a 64-byte block: each newline, plus need_bos coming in, is
+// carried by the add over the whitespace after it into the next statement
+// byte. need_bos carries the newline of a line still open at the block end.
+__attribute__((always_inline, hot))
+inline uint64_t compute_bos_mask(uint64_t nl_mask, uint64_t ws_mask, uint8_t& need_bos) {
+    unsigned long long sum;
+    need_bos = _addcarry_u64(need_bos, ws_mask, nl_mask, &sum);
+    return sum & ~ws_mask;
+}
+
+// Hands one block's events to derived: through filter_events when it has
+// one, then as batch counts or one callback per bit in positional order
+template<typename Derived>
+__attribute__((always_inline, hot))
+inline void emit_events(Derived& derived, uint64_t nl_mask, uint64_t bos_mask, [[maybe_unused]] size_t base_pos) {
+    if constexpr (has_event_filter<Derived>::value) {
+        derived.filter_events(nl_mask, bos_mask, base_pos);
+    }
+    if constexpr (has_batch_support<Derived>::value) {
+        // Fast path: use batch callbacks with popcnt
+        derived.on_eol_batch(_mm_popcnt_u64(nl_mask));
+        derived.on_bos_batch(_mm_popcnt_u64(bos_mask));
+    } else {
+        // Slow path: iterate through each bit in positional order
+        // (bos and eol bits never overlap, so one walk over both suffices)
+        uint64_t events = nl_mask | bos_mask;
+        while (events) {
+            uint64_t event_pos = _tzcnt_u64(events);
+            if ((nl_mask >> event_pos) & 1) {
+                derived.on_eol(base_pos + event_pos);
+            } else {
+                derived.on_bos(base_pos + event_pos);
+            }
+            events &= events - 1;
+        }
+    }
+}
+
 template<typename Derived>
 class ParserBase {
 public:
@@ -16,7 +106,7 @@ public:
         const char* data = buf.start();
         const size_t len = buf.len();
 
-        derived().on_bod(0);
+        begin_document(derived(), buf);
 
         if (len == 0) {
             derived().on_eod(0);
@@ -41,26 +131,14 @@ public:
             __m256i c5 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 160));
 
             // Compute newline masks (3 x 64-bit)
-            uint64_t nl_mask_0 = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, newline_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c0, newline_vec)));
-            uint64_t nl_mask_1 = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c3, newline_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c2, newline_vec)));
-            uint64_t nl_mask_2 = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c5, newline_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c4, newline_vec)));
+            uint64_t nl_mask_0 = load_mask(c0, c1, '\n');
+            uint64_t nl_mask_1 = load_mask(c2, c3, '\n');
+            uint64_t nl_mask_2 = load_mask(c4, c5, '\n');
 
             // Compute space masks (3 x 64-bit)
-            uint64_t sp_mask_0 = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, space_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c0, space_vec)));
-            uint64_t sp_mask_1 = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c3, space_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c2, space_vec)));
-            uint64_t sp_mask_2 = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c5, space_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c4, space_vec)));
+            uint64_t sp_mask_0 = load_mask(c0, c1, ' ');
+            uint64_t sp_mask_1 = load_mask(c2, c3, ' ');
+            uint64_t sp_mask_2 = load_mask(c4, c5, ' ');
 
             // Compute whitespace masks
             uint64_t ws_mask_0 = sp_mask_0 | nl_mask_0;
@@ -68,16 +146,16 @@ public:
             uint64_t ws_mask_2 = sp_mask_2 | nl_mask_2;
 
             // Compute BOS masks using add-with-carry (3 parallel chains)
-            uint64_t bos_mask_0 = compute_bos_mask(nl_mask_0, ws_mask_0, need_bos, need_bos);
-            uint64_t bos_mask_1 = compute_bos_mask(nl_mask_1, ws_mask_1, need_bos, need_bos);
-            uint64_t bos_mask_2 = compute_bos_mask(nl_mask_2, ws_mask_2, need_bos, need_bos);
+            uint64_t bos_mask_0 = compute_bos_mask(nl_mask_0, ws_mask_0, need_bos);
+            uint64_t bos_mask_1 = compute_bos_mask(nl_mask_1, ws_mask_1, need_bos);
+            uint64_t bos_mask_2 = compute_bos_mask(nl_mask_2, ws_mask_2, need_bos);
 
             // Emit events for chunk 0
-            emit_events(nl_mask_0, bos_mask_0, pos);
+            emit_events(derived(), nl_mask_0, bos_mask_0, pos);
             // Emit events for chunk 1
-            emit_events(nl_mask_1, bos_mask_1, pos + 64);
+            emit_events(derived(), nl_mask_1, bos_mask_1, pos + 64);
             // Emit events for chunk 2
-            emit_events(nl_mask_2, bos_mask_2, pos + 128);
+            emit_events(derived(), nl_mask_2, bos_mask_2, pos + 128);
 
             pos += 192;
         }
@@ -87,18 +165,13 @@ public:
             __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
             __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 32));
 
-            uint64_t nl_mask = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, newline_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c0, newline_vec)));
-
-            uint64_t sp_mask = (static_cast<uint64_t>(static_cast<uint32_t>(
-                _mm256_movemask_epi8(_mm256_cmpeq_epi8(c1, space_vec)))) << 32) |
-                static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c0, space_vec)));
+            uint64_t nl_mask = load_mask(c0, c1, '\n');
+            uint64_t sp_mask = load_mask(c0, c1, ' ');
 
             uint64_t ws_mask = sp_mask | nl_mask;
-            uint64_t bos_mask = compute_bos_mask(nl_mask, ws_mask, need_bos, need_bos);
+            uint64_t bos_mask = compute_bos_mask(nl_mask, ws_mask, need_bos);
 
-            emit_events(nl_mask, bos_mask, pos);
+            emit_events(derived(), nl_mask, bos_mask, pos);
             pos += 64;
         }
 
@@ -113,7 +186,7 @@ public:
             uint32_t ws_mask = sp_mask | nl_mask;
             uint32_t bos_mask = compute_bos_mask_32(nl_mask, ws_mask, need_bos, need_bos);
 
-            emit_events_32(nl_mask, bos_mask, pos);
+            emit_events(derived(), nl_mask, bos_mask, pos);
             pos += 32;
         }
 
@@ -136,69 +209,12 @@ public:
 private:
     Derived& derived() { return static_cast<Derived&>(*this); }
 
-    __attribute__((always_inline, hot))
-    static uint64_t compute_bos_mask(uint64_t nl_mask, uint64_t ws_mask, uint8_t need_bos_in, uint8_t& need_bos_out) {
-        unsigned long long sum;
-        need_bos_out = _addcarry_u64(need_bos_in, ws_mask, nl_mask, &sum);
-        return sum & ~ws_mask;
-    }
-
     __attribute__((always_inline, hot))
     static uint32_t compute_bos_mask_32(uint32_t nl_mask, uint32_t ws_mask, uint8_t need_bos_in, uint8_t& need_bos_out) {
         unsigned sum;
         need_bos_out = _addcarry_u32(need_bos_in, ws_mask, nl_mask, &sum);
         return sum & ~ws_mask;
     }
-
-    // SFINAE helper to detect batch support
-    template<typename T, typename = void>
-    struct has_batch_support : std::false_type {};
-
-    template<typename T>
-    struct has_batch_support<T, std::void_t<decltype(T::supports_batch)>>
-        : std::bool_constant<T::supports_batch> {};
-
-    __attribute__((always_inline, hot))
-    void emit_events(uint64_t nl_mask, uint64_t bos_mask, [[maybe_unused]] size_t base_pos) {
-        if constexpr (has_batch_support<Derived>::value) {
-            // Fast path: use batch callbacks with popcnt
-            derived().on_eol_batch(_mm_popcnt_u64(nl_mask));
-            derived().on_bos_batch(_mm_popcnt_u64(bos_mask));
-        } else {
-            // Slow path: iterate through each bit
-            while (nl_mask) {
-                uint64_t nl_pos = _tzcnt_u64(nl_mask);
-                derived().on_eol(base_pos + nl_pos);
-                nl_mask &= nl_mask - 1;
-            }
-            while (bos_mask) {
-                uint64_t bos_pos = _tzcnt_u64(bos_mask);
-                derived().on_bos(base_pos + bos_pos);
-                bos_mask &= bos_mask - 1;
-            }
-        }
-    }
-
-    __attribute__((always_inline, hot))
-    void emit_events_32(uint32_t nl_mask, uint32_t bos_mask, [[maybe_unused]] size_t base_pos) {
-        if constexpr (has_batch_support<Derived>::value) {
-            // Fast path: use batch callbacks with popcnt
-            derived().on_eol_batch(_mm_popcnt_u32(nl_mask));
-            derived().on_bos_batch(_mm_popcnt_u32(bos_mask));
-        } else {
-            // Slow path: iterate through each bit
-            while (nl_mask) {
-                uint32_t nl_pos = _tzcnt_u32(nl_mask);
-                derived().on_eol(base_pos + nl_pos);
-                nl_mask &= nl_mask - 1;
-            }
-            while (bos_mask) {
-                uint32_t bos_pos = _tzcnt_u32(bos_mask);
-                derived().on_bos(base_pos + bos_pos);
-                bos_mask &= bos_mask - 1;
-            }
-        }
-    }
 };
 
 } // namespace yaal
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "parser_base.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace yaal {
+
+struct PathMatch {
+    size_t query;  // index of the matching path in the constructor argument
+    size_t begin;  // offset of the statement's bos
+    size_t end;    // offset of the terminating '\n', or buffer length
+};
+
+// Streaming path queries over the statement tree, without building it.
+//
+// A path such as "server/limits/max_conn" is split on '/' into components;
+// "*" matches any statement. A component matches a statement whose key (the
+// text from bos up to the first ' ', ':' or '\n') equals it, and each
+// following component must match a direct child, i.e. the next statement
+// indented deeper with no non-matching statement in between. Depth is taken
+// from the indentation alone, so nothing is materialised.
+//
+// Once a statement fails to match, its whole subtree is skipped in the SIMD
+// scan: while every query is blocked at indentation d, filter_events clears
+// the eol and bos bits of each block up to the first bos at column d or
+// less, found with the block's newline mask smeared over the next d + 1
+// bytes. The skipped statements never reach a callback, so no key is looked
+// at. Several paths can be run in one pass; matches are reported in
+// document order.
+class PathQuery : public ParserBase<PathQuery> {
+public:
+    explicit PathQuery(const std::vector<std::string>& paths) {
+        queries_.reserve(paths.size());
+        for (const auto& path : paths) {
+            queries_.push_back(compile(path));
+        }
+    }
+
+    __attribute__((always_inline)) void on_buffer(const Buffer& buf) {
+        data_ = buf.start();
+        len_ = buf.len();
+    }
+
+    __attribute__((always_inline)) void on_bod(size_t) {
+        line_start_ = 0;
+        skip_indent_ = npos;
+        for (auto& q : queries_) {
+            q.indents.clear();
+            q.blocked = npos;
+        }
+    }
+
+    __attribute__((always_inline)) void on_bos(size_t offset) {
+        const size_t indent = offset - line_start_;
+
+        // Inside a subtree that no query can match: skip without comparing
+        if (indent > skip_indent_) return;
+
+        skip_indent_ = npos;
+        bool all_blocked = true;
+        size_t max_blocked = 0;
+
+        for (size_t i = 0; i < queries_.size(); i++) {
+            Query& q = queries_[i];
+
+            if (q.blocked == npos || indent <= q.blocked) {
+                q.blocked = npos;
+                while (!q.indents.empty() && q.indents.back() >= indent) {
+                    q.indents.pop_back();
+                }
+
+                const size_t depth = q.indents.size();
+                if (key_matches(q.components[depth], offset)) {
+                    if (depth + 1 == q.components.size()) {
+                        matches_.push_back(PathMatch{i, offset, npos});
+                        q.blocked = indent;
+                    } else {
+                        q.indents.push_back(indent);
+                    }
+                } else {
+                    q.blocked = indent;
+                }
+            }
+
+            if (q.blocked == npos) {
+                all_blocked = false;
+            } else if (q.blocked > max_blocked) {
+                max_blocked = q.blocked;
+            }
+        }
+
+        if (all_blocked) skip_indent_ = max_blocked;
+    }
+
+    __attribute__((always_inline)) void on_eol(size_t offset) {
+        close_pending(offset);
+        line_start_ = offset + 1;
+    }
+
+    __attribute__((always_inline)) void on_eod(size_t offset) { close_pending(offset); }
+
+    static constexpr bool supports_event_filter = true;
+
+    // Drops the events of a skipped subtree, up to the first bos that is
+    // not indented deeper than skip_indent_, keeping line_start_ current
+    __attribute__((always_inline))
+    void filter_events(uint64_t& nl_mask, uint64_t& bos_mask, size_t base_pos) {
+        // A match waiting for its end offset needs the next eol
+        if (skip_indent_ == npos || pending_ < matches_.size()) return;
+
+        const uint64_t shallow = bos_mask & near_line_start(nl_mask, base_pos, skip_indent_);
+        const uint64_t skipped = shallow ? (shallow & -shallow) - 1 : ~uint64_t(0);
+        const uint64_t skipped_nl = nl_mask & skipped;
+        if (skipped_nl) line_start_ = base_pos + 64 - __builtin_clzll(skipped_nl);
+        nl_mask &= ~skipped;
+        bos_mask &= ~skipped;
+    }
+
+    const std::vector<PathMatch>& matches() const { return matches_; }
+
+    void reset() {
+        matches_.clear();
+        pending_ = 0;
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    struct Component {
+        std::string key;
+        bool wildcard;
+    };
+
+    struct Query {
+        std::vector<Component> components;
+        std::vector<size_t> indents;  // indentation of each matched ancestor
+        size_t blocked = npos;        // indentation of the non-matching subtree we are in
+    };
+
+    std::vector<Query> queries_;
+    std::vector<PathMatch> matches_;
+    size_t pending_ = 0;  // first match still waiting for its end offset
+    const char* data_ = nullptr;
+    size_t len_ = 0;
+    size_t line_start_ = 0;
+    size_t skip_indent_ = npos;  // npos unless every query is blocked
+
+    static Query compile(const std::string& path) {
+        Query q;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t slash = path.find('/', start);
+            if (slash == std::string::npos) slash = path.size();
+            if (slash > start) {
+                std::string key = path.substr(start, slash - start);
+                bool wildcard = key == "*";
+                q.components.push_back(Component{std::move(key), wildcard});
+            }
+            start = slash + 1;
+        }
+        // An empty path behaves like "*"
+        if (q.components.empty()) q.components.push_back(Component{"*", true});
+        return q;
+    }
+
+    bool key_matches(const Component& c, size_t offset) const {
+        if (c.wildcard) return true;
+        const size_t n = c.key.size();
+        if (n > len_ - offset) return false;
+        if (std::memcmp(data_ + offset, c.key.data(), n) != 0) return false;
+        if (offset + n == len_) return true;
+        const char next = data_[offset + n];
+        return next == ' ' || next == ':' || next == '\n';
+    }
+
+    // Bits of the block at most indent bytes after a line start: a
+    // newline within the indent + 1 bytes before them, or the current line
+    // having started that recently
+    __attribute__((always_inline))
+    uint64_t near_line_start(uint64_t nl_mask, size_t base_pos, size_t indent) const {
+        const size_t span = indent < 63 ? indent + 1 : 64;
+        uint64_t smear = nl_mask;
+        size_t covered = 1;
+        while (covered * 2 <= span) {
+            smear |= smear << covered;
+            covered *= 2;
+        }
+        smear |= smear << (span - covered);
+        uint64_t near = smear << 1;
+
+        const size_t reach = line_start_ + indent + 1;
+        if (reach > base_pos) near |= reach - base_pos >= 64 ? ~uint64_t(0) : (uint64_t(1) << (reach - base_pos)) - 1;
+        return near;
+    }
+
+    __attribute__((always_inline)) void close_pending(size_t offset) {
+        while (pending_ < matches_.size()) {
+            matches_[pending_++].end = offset;
+        }
+    }
+};
+
+} // namespace yaal
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "counting_parser.hpp"
+#include "parser_base.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+
+namespace yaal {
+
+// Carry-select variant of the ParserBase kernel.
+//
+// ParserBase chains its bos masks through need_bos with _addcarry_u64, so
+// block i + 1 cannot start its add until block i is done. Here every 64-byte
+// block computes its bos mask for both possible incoming carries (the two
+// differ by at most one bit), with no dependency between blocks. Each block
+// then either generates a carry (carry-out even with carry-in 0), propagates
+// it (carry-out only with carry-in 1) or kills it. Packing the
+// generate/propagate bits of the 8 blocks of a 512-byte iteration into
+// bytes, one integer add resolves every true carry-in at once, the same way
+// a carry-lookahead adder does, and the right mask is then selected per
+// block. Batch consumers skip the masks
+// altogether and only resolve which of the optional bits count.
+//
+// Events, callbacks and batch support are identical to ParserBase.
+template<typename Derived>
+class SpeculativeParserBase {
+public:
+    __attribute__((flatten, hot, noinline))
+    void parse(const Buffer& buf) {
+        const char* data = buf.start();
+        const size_t len = buf.len();
+
+        begin_document(derived(), buf);
+
+        if (len == 0) {
+            derived().on_eod(0);
+            return;
+        }
+
+        size_t pos = 0;
+        uint8_t need_bos = true;
+
+        // Main loop: 512 bytes at a time (8x64 bytes), no carry chain between blocks
+        while (pos + 512 <= len) {
+            if constexpr (has_batch_support<Derived>::value) {
+                // Counts only: the carry can add at most one bos per block,
+                // so only those bits need resolving
+                uint64_t eol_count = 0;
+                uint64_t bos_count = 0;
+                uint32_t generate = 0;
+                uint32_t propagate = 0;
+                uint32_t extra = 0;
+
+                for (int b = 0; b < 8; b++) {
+                    Block blk = speculate(data + pos + 64 * b);
+                    eol_count += _mm_popcnt_u64(blk.nl_mask);
+                    bos_count += _mm_popcnt_u64(blk.bos_if_0);
+                    generate |= blk.generate << b;
+                    propagate |= blk.propagate << b;
+                    extra |= uint32_t(blk.extra_bos != 0) << b;
+                }
+
+                const uint32_t carries = resolve(generate, propagate, need_bos);
+                derived().on_eol_batch(eol_count);
+                derived().on_bos_batch(bos_count + _mm_popcnt_u32(extra & carries));
+            } else {
+                Block blk[8];
+                uint32_t generate = 0;
+                uint32_t propagate = 0;
+
+                for (int b = 0; b < 8; b++) {
+                    blk[b] = speculate(data + pos + 64 * b);
+                    generate |= blk[b].generate << b;
+                    propagate |= blk[b].propagate << b;
+                }
+
+                const uint32_t carries = resolve(generate, propagate, need_bos);
+                for (int b = 0; b < 8; b++) {
+                    const uint64_t select = uint64_t(0) - ((carries >> b) & 1);
+                    emit_events(derived(), blk[b].nl_mask, blk[b].bos_if_0 | (blk[b].extra_bos & select),
+                                pos + 64 * b);
+                }
+            }
+
+            pos += 512;
+        }
+
+        // Remaining 64-byte blocks use the serial carry
+        while (pos + 64 <= len) {
+            serial_block(data + pos, need_bos, pos);
+            pos += 64;
+        }
+
+        // Tail padded with spaces, which produce neither eol nor bos
+        if (pos < len) {
+            alignas(32) char tail[64];
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, data + pos, len - pos);
+            serial_block(tail, need_bos, pos);
+        }
+
+        derived().on_eod(len);
+    }
+
+private:
+    Derived& derived() { return static_cast<Derived&>(*this); }
+
+    // One 64-byte block evaluated for both incoming carries. With carry-in 1
+    // the only extra bos is the block's first non-space byte, provided no
+    // newline comes before it; the carry-out differs only for an all-space
+    // block, which propagates.
+    struct Block {
+        uint64_t nl_mask;
+        uint64_t bos_if_0;   // bos mask for carry-in 0
+        uint64_t extra_bos;  // bit added to bos_if_0 by carry-in 1
+        uint32_t generate;   // carry-out with carry-in 0
+        uint32_t propagate;  // carry-out only with carry-in 1
+    };
+
+    __attribute__((always_inline))
+    static Block speculate(const char* p) {
+        const __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        Block blk;
+        blk.nl_mask = load_mask(c0, c1, '\n');
+        const uint64_t sp_mask = load_mask(c0, c1, ' ');
+        const uint64_t ws_mask = sp_mask | blk.nl_mask;
+        const uint64_t sum = ws_mask + blk.nl_mask;
+        blk.bos_if_0 = sum & ~ws_mask;
+        blk.extra_bos = _blsi_u64(~sp_mask) & ~blk.nl_mask;
+        blk.generate = sum < ws_mask;
+        blk.propagate = sp_mask == ~uint64_t(0);
+        return blk;
+    }
+
+    // Bit b of the result is the true carry into block b; bit 8 is the carry
+    // out of the iteration
+    __attribute__((always_inline))
+    static uint32_t resolve(uint32_t generate, uint32_t propagate, uint8_t& need_bos) {
+        const uint32_t alive = generate | propagate;
+        const uint32_t carries = (alive + generate + need_bos) ^ alive ^ generate;
+        need_bos = static_cast<uint8_t>((carries >> 8) & 1);
+        return carries;
+    }
+
+    // One 64-byte block on the serial carry, as in ParserBase
+    __attribute__((always_inline))
+    void serial_block(const char* p, uint8_t& need_bos, size_t base_pos) {
+        const __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        const uint64_t nl_mask = load_mask(c0, c1, '\n');
+        const uint64_t ws_mask = load_mask(c0, c1, ' ') | nl_mask;
+        emit_events(derived(), nl_mask, compute_bos_mask(nl_mask, ws_mask, need_bos), base_pos);
+    }
+};
+
+// CountingParser on top of the carry-select kernel
+using SpeculativeCountingParser = BasicCountingParser<SpeculativeParserBase>;
+
+} // namespace yaal
@@ -0,0 +1,192 @@
+#pragma once
+
+#include "parser_base.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <immintrin.h>
+#include <string>
+#include <vector>
+
+namespace yaal {
+
+struct SearchHit {
+    uint64_t line;  // zero-based line index
+    size_t begin;   // offset of the statement's bos
+    size_t end;     // offset of the terminating '\n', or buffer length
+};
+
+// Finds all statements containing a substring.
+//
+// Runs the ParserBase mask kernel (load_mask, compute_bos_mask) and, on the
+// same loaded chunks, compares against the first and last needle bytes. The
+// first-byte mask is shifted by the needle length (carrying across 64-byte
+// blocks) and ANDed with the last-byte mask, so only positions where both
+// ends agree are verified with memcmp. Each verified hit is mapped to its
+// line and statement through the eol and bos masks, and the bos of a line
+// begun in an earlier block is carried across blocks like need_bos; a
+// statement is reported once no matter how many hits it contains.
+//
+// Needles longer than 64 bytes are prefiltered on their last 64 bytes. A
+// needle containing '\n' can never lie within a statement and matches
+// nothing.
+class StatementSearch {
+public:
+    explicit StatementSearch(std::string needle) : needle_(std::move(needle)) {
+        const size_t n = needle_.size();
+        searchable_ = n > 0 && needle_.find('\n') == std::string::npos;
+        if (searchable_) {
+            shift_ = n < 64 ? n - 1 : 63;
+            first_ = needle_[n - 1 - shift_];
+            last_ = needle_[n - 1];
+        }
+    }
+
+    const std::string& needle() const { return needle_; }
+
+    __attribute__((hot, noinline))
+    std::vector<SearchHit> search(const Buffer& buf) const {
+        Hits out;
+        out.data = buf.start();
+        out.len = buf.len();
+        if (!searchable_ || out.len < needle_.size()) return std::move(out.hits);
+
+        const char* data = out.data;
+        const size_t len = out.len;
+        size_t pos = 0;
+        Carry carry;
+        carry.first = first_;
+        carry.last = last_;
+        carry.shift = shift_;
+
+        while (pos + 64 <= len) {
+            process_block(carry, out, data + pos, pos);
+            pos += 64;
+        }
+
+        if (pos < len) {
+            // Pad the tail with spaces: they never start a statement, and
+            // candidates past the end fail the length check before memcmp
+            alignas(32) char tail[64];
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, data + pos, len - pos);
+            process_block(carry, out, tail, pos);
+        }
+
+        if (out.pending) out.hits.back().end = len;
+        return std::move(out.hits);
+    }
+
+private:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    // Per-block carries, kept in registers by the hot loop
+    struct Carry {
+        char first;
+        char last;
+        size_t shift;
+        uint8_t need_bos = true;
+        uint64_t prev_first = 0;  // first-byte mask of the previous block
+        uint64_t lines = 0;       // newlines before the current block
+        size_t line_bos = npos;   // bos of the line open at the block start
+    };
+
+    // Hit state, only touched when a candidate shows up
+    struct Hits {
+        const char* data = nullptr;
+        size_t len = 0;
+        uint64_t last_line = npos;
+        bool pending = false;  // last hit still needs its end offset
+        std::vector<SearchHit> hits;
+    };
+
+    std::string needle_;
+    size_t shift_ = 0;
+    char first_ = 0;
+    char last_ = 0;
+    bool searchable_ = false;
+
+    // Bits 0..bit inclusive
+    __attribute__((always_inline))
+    static uint64_t mask_upto(uint64_t bit) { return (uint64_t(2) << bit) - 1; }
+
+    __attribute__((always_inline, hot))
+    void process_block(Carry& carry, Hits& out, const char* block, size_t base) const {
+        __m256i c0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        __m256i c1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32));
+
+        uint64_t nl_mask = load_mask(c0, c1, '\n');
+        uint64_t ws_mask = load_mask(c0, c1, ' ') | nl_mask;
+        uint64_t first_mask = load_mask(c0, c1, carry.first);
+        uint64_t last_mask = load_mask(c0, c1, carry.last);
+
+        uint64_t bos_mask = compute_bos_mask(nl_mask, ws_mask, carry.need_bos);
+
+        // Candidate end positions: last byte here, first byte shift earlier
+        uint64_t shifted_first = first_mask << carry.shift;
+        if (carry.shift > 0) shifted_first |= carry.prev_first >> (64 - carry.shift);
+        uint64_t candidates = last_mask & shifted_first;
+        carry.prev_first = first_mask;
+
+        if (__builtin_expect(candidates != 0 || out.pending, 0)) {
+            verify_block(carry, out, base, candidates, nl_mask, bos_mask);
+        }
+
+        carry.lines += _mm_popcnt_u64(nl_mask);
+
+        // The last event of the block decides the open line's bos: a bos
+        // opens it here, a newline leaves the next line without one yet, and
+        // a block without events keeps it. Disjoint masks compare like their
+        // highest bits. Selected with masks, since whether a block ends in a
+        // statement or in indentation does not predict; npos is all ones.
+        const uint64_t opened = uint64_t(0) - (bos_mask > nl_mask);
+        const uint64_t kept = uint64_t(0) - ((nl_mask | bos_mask) == 0);
+        const uint64_t line_bos = (opened & (base + 63 - _lzcnt_u64(bos_mask))) | ~opened;
+        carry.line_bos = (carry.line_bos & kept) | (line_bos & ~kept);
+    }
+
+    __attribute__((noinline))
+    void verify_block(const Carry& carry, Hits& out, size_t base, uint64_t candidates,
+                      uint64_t nl_mask, uint64_t bos_mask) const {
+        if (out.pending && nl_mask) {
+            out.hits.back().end = base + _tzcnt_u64(nl_mask);
+            out.pending = false;
+        }
+
+        const size_t n = needle_.size();
+        while (candidates) {
+            uint64_t bit = _tzcnt_u64(candidates);
+            candidates &= candidates - 1;
+
+            const size_t end_pos = base + bit;  // position of the needle's last byte
+            if (end_pos >= out.len || end_pos + 1 < n) continue;
+
+            uint64_t nl_before = nl_mask & (mask_upto(bit) >> 1);
+            uint64_t line = carry.lines + _mm_popcnt_u64(nl_before);
+            if (line == out.last_line) continue;
+
+            if (std::memcmp(out.data + end_pos + 1 - n, needle_.data(), n) != 0) continue;
+
+            // Statement start: the line's bos at or before the hit, taken
+            // from the bos mask when the line starts in this block
+            size_t stmt_begin;
+            uint64_t line_bos_bits = bos_mask & mask_upto(bit);
+            if (nl_before) {
+                line_bos_bits &= ~mask_upto(63 - __builtin_clzll(nl_before));
+                stmt_begin = line_bos_bits ? base + _tzcnt_u64(line_bos_bits) : npos;
+            } else {
+                stmt_begin = line_bos_bits ? base + _tzcnt_u64(line_bos_bits) : carry.line_bos;
+            }
+            if (stmt_begin > end_pos) continue;  // hit lies in indentation only
+
+            uint64_t nl_after = nl_mask & ~mask_upto(bit);
+            size_t stmt_end = nl_after ? base + _tzcnt_u64(nl_after) : npos;
+
+            out.hits.push_back(SearchHit{line, stmt_begin, stmt_end});
+            out.last_line = line;
+            out.pending = stmt_end == npos;
+        }
+    }
+};
+
+} // namespace yaal
@@ -0,0 +1,252 @@
+#pragma once
+
+#include "event_sink.hpp"
+#include "parser_base.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <immintrin.h>
+#include <vector>
+
+namespace yaal {
+
+// Destination for Writer output. Writes arrive in chunks of up to the
+// writer's buffer size, or larger when a long unchanged run is passed through.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    virtual void write(const char* data, size_t len) = 0;
+};
+
+// OutputSink appending to a stdio stream. A short write (disk full, closed
+// pipe, stream not open for writing) sets failed(), which stays set: later
+// writes are dropped so the file never continues past a gap.
+class FileSink : public OutputSink {
+public:
+    explicit FileSink(std::FILE* file) : file_(file) {}
+
+    void write(const char* data, size_t len) override {
+        if (failed_) return;
+        failed_ = std::fwrite(data, 1, len, file_) != len;
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    std::FILE* file_;
+    bool failed_ = false;
+};
+
+// Rewrites a document in normal form: every statement indented by
+// indent_width spaces per nesting level, trailing spaces stripped, blank
+// lines dropped and every statement terminated by '\n'. Nesting is taken
+// from the indentation alone, as in PathQuery: a statement is a child of
+// the closest preceding statement indented less.
+//
+// Lines that are already in normal form are not copied one by one: they
+// extend a pending run of input bytes, and the run is appended in one copy
+// when a line needs rewriting, or handed to the sink directly when it is
+// at least a buffer long. An already normalized document therefore goes
+// out in a single write. Rewritten lines are assembled in the buffer with
+// fixed-size vector copies.
+//
+// Offsets come either from the writer's own scan (parse) or from events
+// recorded earlier (write), e.g. by a BufferedSinkParser.
+class Writer : public ParserBase<Writer> {
+public:
+    static constexpr size_t default_buffer_size = size_t(1) << 20;
+
+    explicit Writer(OutputSink& sink, size_t indent_width = 2, size_t buffer_size = default_buffer_size)
+        : sink_(&sink),
+          width_(indent_width),
+          capacity_(std::max(buffer_size, size_t(64))),
+          buffer_(capacity_ + slack) {}
+
+    __attribute__((always_inline)) void on_buffer(const Buffer& buf) { data_ = buf.start(); }
+
+    // Replays the events of a parse of buf. A document's events may be
+    // split over several calls, as EventSink batches are.
+    void write(const Buffer& buf, const Event* events, size_t count) {
+        on_buffer(buf);
+        for (size_t i = 0; i < count; i++) {
+            const size_t offset = events[i].offset();
+            switch (events[i].kind()) {
+                case EventKind::bod: on_bod(offset); break;
+                case EventKind::bos: on_bos(offset); break;
+                case EventKind::eol: on_eol(offset); break;
+                case EventKind::eod: on_eod(offset); break;
+            }
+        }
+    }
+
+    __attribute__((always_inline)) void on_bod(size_t) {
+        line_start_ = 0;
+        run_begin_ = 0;
+        run_end_ = 0;
+        open_ = false;
+        indents_.clear();
+    }
+
+    __attribute__((always_inline)) void on_bos(size_t offset) {
+        bos_ = offset;
+        open_ = true;
+    }
+
+    __attribute__((always_inline)) void on_eol(size_t offset) {
+        if (open_) statement(offset, true);
+        line_start_ = offset + 1;
+    }
+
+    void on_eod(size_t offset) {
+        if (open_) statement(offset, false);
+        put(data_ + run_begin_, run_end_ - run_begin_);
+        flush();
+    }
+
+    // Hands buffered output to the sink
+    void flush() {
+        if (used_ > 0) {
+            sink_->write(buffer_.data(), used_);
+            written_ += used_;
+            used_ = 0;
+        }
+    }
+
+    // Bytes handed to the sink so far
+    uint64_t bytes_written() const { return written_; }
+
+    void reset() {
+        used_ = 0;
+        written_ = 0;
+    }
+
+private:
+    // Vector copies may store up to 32 bytes past the end of their data
+    static constexpr size_t slack = 64;
+
+    OutputSink* sink_;
+    size_t width_;
+    size_t capacity_;
+    std::vector<char> buffer_;
+    size_t used_ = 0;
+    uint64_t written_ = 0;
+
+    const char* data_ = nullptr;
+    std::vector<size_t> indents_;  // input indentation of each open ancestor
+    size_t line_start_ = 0;
+    size_t bos_ = 0;
+    bool open_ = false;
+    size_t run_begin_ = 0;  // pending run of input already in normal form
+    size_t run_end_ = 0;
+
+    __attribute__((always_inline))
+    void statement(size_t eol, bool has_newline) {
+        open_ = false;
+        const size_t indent = bos_ - line_start_;
+        while (!indents_.empty() && indents_.back() >= indent) {
+            indents_.pop_back();
+        }
+        const size_t out_indent = indents_.size() * width_;
+        indents_.push_back(indent);
+
+        if (__builtin_expect(has_newline && indent == out_indent && data_[eol - 1] != ' ', 1)) {
+            if (line_start_ != run_end_) {
+                put(data_ + run_begin_, run_end_ - run_begin_);
+                run_begin_ = line_start_;
+            }
+            run_end_ = eol + 1;
+            return;
+        }
+
+        put(data_ + run_begin_, run_end_ - run_begin_);
+        size_t end = eol;
+        while (data_[end - 1] == ' ') end--;
+        put_line(out_indent, data_ + bos_, end - bos_);
+        run_begin_ = eol + 1;
+        run_end_ = eol + 1;
+    }
+
+    __attribute__((always_inline))
+    void put(const char* p, size_t n) {
+        if (__builtin_expect(n > capacity_ - used_, 0)) {
+            flush();
+            if (n >= capacity_) {
+                sink_->write(p, n);
+                written_ += n;
+                return;
+            }
+        }
+        copy_bytes(buffer_.data() + used_, p, n);
+        used_ += n;
+    }
+
+    // Indentation, body and '\n' of a rewritten line
+    __attribute__((always_inline))
+    void put_line(size_t indent, const char* p, size_t n) {
+        if (__builtin_expect(indent <= 32 && indent + n + 1 <= capacity_ - used_, 1)) {
+            char* dst = buffer_.data() + used_;
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_set1_epi8(' '));
+            copy_bytes(dst + indent, p, n);
+            dst[indent + n] = '\n';
+            used_ += indent + n + 1;
+            return;
+        }
+        put_spaces(indent);
+        put(p, n);
+        put("\n", 1);
+    }
+
+    void put_spaces(size_t n) {
+        const __m256i spaces = _mm256_set1_epi8(' ');
+        while (n > 0) {
+            if (used_ == capacity_) flush();
+            const size_t chunk = std::min(n, capacity_ - used_);
+            char* dst = buffer_.data() + used_;
+            for (size_t i = 0; i < chunk; i += 32) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), spaces);
+            }
+            used_ += chunk;
+            n -= chunk;
+        }
+    }
+
+    // Short copies with overlapping fixed-size loads, longer ones 32 bytes
+    // at a time; never reads outside [src, src + n)
+    __attribute__((always_inline))
+    static void copy_bytes(char* dst, const char* src, size_t n) {
+        if (n >= 32) {
+            const __m256i last = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + n - 32));
+            for (size_t i = 0; i + 32 < n; i += 32) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+                                    _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + n - 32), last);
+        } else if (n >= 16) {
+            const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + n - 16));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), head);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + n - 16), tail);
+        } else if (n >= 8) {
+            uint64_t head, tail;
+            std::memcpy(&head, src, 8);
+            std::memcpy(&tail, src + n - 8, 8);
+            std::memcpy(dst, &head, 8);
+            std::memcpy(dst + n - 8, &tail, 8);
+        } else if (n >= 4) {
+            uint32_t head, tail;
+            std::memcpy(&head, src, 4);
+            std::memcpy(&tail, src + n - 4, 4);
+            std::memcpy(dst, &head, 4);
+            std::memcpy(dst + n - 4, &tail, 4);
+        } else if (n > 0) {
+            dst[0] = src[0];
+            dst[n >> 1] = src[n >> 1];
+            dst[n - 1] = src[n - 1];
+        }
+    }
+};
+
+} // namespace yaal
@@ -1,5 +1,17 @@
+#include "benchmark_plugins.hpp"
+#include "yaal/block_scalar.hpp"
+#include "yaal/corpus_generator.hpp"
 #include "yaal/counting_parser.hpp"
+#include "yaal/diff.hpp"
+#include "yaal/event_sink.hpp"
+#include "yaal/fanout.hpp"
+#include "yaal/json_transcoder.hpp"
+#include "yaal/path_query.hpp"
+#include "yaal/quoted_parser.hpp"
 #include "yaal/reference_parser.hpp"
+#include "yaal/speculative_parser.hpp"
+#include "yaal/statement_search.hpp"
+#include "yaal/writer.hpp"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -8,7 +20,10 @@
 #include <iomanip>
 #include <cstring>
 #include <random>
+#include <algorithm>
 #include <immintrin.h>
+#include <iterator>
+#include <thread>
 
 // Fast xorshift64 PRNG
 class FastRandom {
@@ -46,48 +61,87 @@ struct GeneratedDocument {
     uint64_t expected_bos;
 };
 
-GeneratedDocument generate_document(
-    const std::vector<std::string>& words,
-    size_t target_size,
-    size_t avg_words_per_line,
-    size_t avg_lines_per_indent_level,
-    uint64_t seed = 42
-) {
+// Built-in corpus, as yaal_gen would write it with --indent-width 4
+// --max-depth 10 --mean-line 80 --blank-ratio 0 --comment-ratio 0: plain
+// statements of dictionary words already in width-4 normal form
+GeneratedDocument generate_corpus(const std::vector<std::string>& words, size_t target_size, uint64_t seed = 42) {
+    yaal::CorpusShape shape;
+    shape.mean_line_length = 80;
+    shape.blank_ratio = 0;
+    shape.comment_ratio = 0;
+    shape.indent_width = 4;
+    shape.max_depth = 10;
+    GeneratedDocument doc;
+    const unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    const yaal::CorpusCounts counts = yaal::CorpusGenerator(shape, seed, words).generate(target_size, threads, doc.data);
+    doc.expected_eol = counts.eol;
+    doc.expected_bos = counts.bos;
+    return doc;
+}
+
+// Corpus written by yaal_gen, with the expected counts from its sidecar
+bool load_corpus(const char* path, GeneratedDocument& doc) {
+    std::ifstream file(path, std::ios::binary);
+    std::ifstream sidecar(std::string(path) + ".counts");
+    yaal::CorpusCounts counts;
+    if (!file || !sidecar || !counts.read(sidecar)) return false;
+    doc.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    doc.expected_eol = counts.eol;
+    doc.expected_bos = counts.bos;
+    return doc.data.size() == counts.bytes;
+}
+
+// Document dominated by block scalars: each statement owns a 256-line
+// base64-like block, as with embedded certificates or scripts
+GeneratedDocument generate_block_document(size_t target_size, uint64_t seed = 42) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
     FastRandom rng(seed);
     std::vector<char> doc;
-    doc.reserve(target_size + 1024);
+    doc.reserve(target_size + 4096);
 
     uint64_t eol_count = 0;
     uint64_t bos_count = 0;
 
-    const size_t num_words = words.size();
-    int current_indent = 0;
-    size_t lines_at_current_indent = 0;
-
+    auto append = [&doc](const char* s) { doc.insert(doc.end(), s, s + std::strlen(s)); };
     while (doc.size() < target_size) {
-        lines_at_current_indent++;
-        if (lines_at_current_indent >= avg_lines_per_indent_level) {
-            uint64_t r = rng.next(3);
-            if (r == 0 && current_indent > 0) current_indent--;
-            else if (r == 1 && current_indent < 10) current_indent++;
-            lines_at_current_indent = 0;
+        append("  certificate: |\n");
+        for (int line = 0; line < 256; line++) {
+            append("    ");
+            for (int i = 0; i < 64; i++) doc.push_back(alphabet[rng.next(64)]);
+            doc.push_back('\n');
         }
+        append("  issuer: yaal\n");
+        eol_count += 258;
+        bos_count += 2;
+    }
+    return {std::move(doc), eol_count, bos_count};
+}
 
-        for (int i = 0; i < current_indent * 4; i++) doc.push_back(' ');
+// Document of quoted values: each statement's value is a string running
+// over 4 lines, with an escaped quote and an escaped backslash inside
+GeneratedDocument generate_quoted_document(const std::vector<std::string>& words, size_t target_size,
+                                           uint64_t seed = 42) {
+    FastRandom rng(seed);
+    std::vector<char> doc;
+    doc.reserve(target_size + 1024);
 
-        size_t num_words_this_line = 1 + rng.next(avg_words_per_line * 2);
-        for (size_t w = 0; w < num_words_this_line; w++) {
-            if (w > 0) doc.push_back(' ');
-            const std::string& word = words[rng.next(num_words)];
-            for (char c : word) doc.push_back(c);
+    uint64_t statements = 0;
+    auto append = [&doc](const std::string& s) { doc.insert(doc.end(), s.begin(), s.end()); };
+    while (doc.size() < target_size) {
+        append("  ");
+        append(words[rng.next(words.size())]);
+        append(": \"");
+        for (int line = 0; line < 4; line++) {
+            if (line > 0) append("\n    ");
+            for (int w = 0; w < 6; w++) {
+                if (w > 0) doc.push_back(' ');
+                append(words[rng.next(words.size())]);
+            }
         }
-        doc.push_back('\n');
-
-        // Count events: each line has one newline and one BOS (first non-space char)
-        eol_count++;
-        bos_count++;  // Every generated line has at least one word
+        append(" \\\"quoted\\\" C:\\\\\"\n");
+        statements++;
     }
-    return {std::move(doc), eol_count, bos_count};
+    return {std::move(doc), statements, statements};
 }
 
 // Measure READ-ONLY memory throughput using sum (not memcpy!)
@@ -165,7 +219,9 @@ double measure_newline_throughput(const char* data, size_t len, int iterations)
     return (static_cast<double>(len) * iterations) / elapsed_sec;
 }
 
-double measure_parser_throughput(const yaal::Buffer& buf, yaal::CountingParser& parser, int iterations) {
+// Harness for any parser exposing reset() and parse(buf)
+template<typename Parser>
+double measure_throughput(const yaal::Buffer& buf, Parser& parser, int iterations) {
     parser.reset();
     parser.parse(buf);
 
@@ -180,14 +236,162 @@ double measure_parser_throughput(const yaal::Buffer& buf, yaal::CountingParser&
     return (static_cast<double>(buf.len()) * iterations) / elapsed_sec;
 }
 
-double measure_reference_parser_throughput(const yaal::Buffer& buf, yaal::ReferenceParser& parser, int iterations) {
-    parser.reset();
-    parser.parse(buf);
+// Three consumers fused into one scan
+using TripleCounter = yaal::Fanout<yaal::CountingParser, yaal::CountingParser, yaal::CountingParser>;
+
+// The same three consumers, each doing its own pass over memory
+struct SeparatePasses {
+    void reset() {
+        for (auto& p : parsers) p.reset();
+    }
+
+    void parse(const yaal::Buffer& buf) {
+        for (auto& p : parsers) p.parse(buf);
+    }
+
+    yaal::CountingParser parsers[3];
+};
+
+// Direct CRTP consumer without batch support: one inlined call per event
+class PerEventCountingParser : public yaal::ParserBase<PerEventCountingParser> {
+public:
+    void on_bod(size_t) {}
+    void on_bos(size_t) { bos++; }
+    void on_eol(size_t) { eol++; }
+    void on_eod(size_t) {}
+
+    void reset() { bos = eol = 0; }
+
+    uint64_t bos = 0;
+    uint64_t eol = 0;
+};
+
+// One indirect call per event into a plugin handler
+class VirtualDispatchParser : public yaal::ParserBase<VirtualDispatchParser> {
+public:
+    explicit VirtualDispatchParser(VirtualEventHandler& handler) : handler_(&handler) {}
+
+    void on_bod(size_t offset) { handler_->on_event(yaal::EventKind::bod, offset); }
+    void on_bos(size_t offset) { handler_->on_event(yaal::EventKind::bos, offset); }
+    void on_eol(size_t offset) { handler_->on_event(yaal::EventKind::eol, offset); }
+    void on_eod(size_t offset) { handler_->on_event(yaal::EventKind::eod, offset); }
+
+    void reset() {}
+
+private:
+    VirtualEventHandler* handler_;
+};
+
+// Output sink copying into a preallocated area, like a page-cache write.
+// Grows when the estimate was short, so only the first pass reallocates.
+class MemoryOutputSink : public yaal::OutputSink {
+public:
+    explicit MemoryOutputSink(size_t capacity) : out_(capacity) {}
+
+    void write(const char* data, size_t len) override {
+        if (len > out_.size() - used_) out_.resize(std::max(out_.size() * 2, used_ + len));
+        std::memcpy(out_.data() + used_, data, len);
+        used_ += len;
+    }
+
+    void reset() { used_ = 0; }
+    const char* data() const { return out_.data(); }
+    size_t size() const { return used_; }
+
+private:
+    std::vector<char> out_;
+    size_t used_ = 0;
+};
+
+// Parse + normalize round trip through yaal::Writer
+class NormalizeRoundTrip {
+public:
+    NormalizeRoundTrip(size_t capacity, size_t width) : sink_(capacity), writer_(sink_, width) {}
+
+    void reset() {
+        sink_.reset();
+        writer_.reset();
+    }
+    void parse(const yaal::Buffer& buf) { writer_.parse(buf); }
+    size_t size() const { return sink_.size(); }
+
+private:
+    MemoryOutputSink sink_;
+    yaal::Writer writer_;
+};
+
+// Parse + JSON transcode into a memory sink through a 1 MB buffer
+class JsonRoundTrip {
+public:
+    explicit JsonRoundTrip(size_t capacity) : sink_(capacity), transcoder_(sink_) {}
+
+    void reset() {
+        sink_.reset();
+        transcoder_.reset();
+    }
+    void parse(const yaal::Buffer& buf) { transcoder_.parse(buf); }
+    const char* data() const { return sink_.data(); }
+    size_t size() const { return sink_.size(); }
+    size_t memory_footprint() const { return transcoder_.memory_footprint(); }
+
+private:
+    MemoryOutputSink sink_;
+    yaal::JsonTranscoder transcoder_;
+};
+
+// The same normalization one byte at a time, appending to a string
+class BytewiseNormalizer {
+public:
+    explicit BytewiseNormalizer(size_t width) : width_(width) {}
+
+    void reset() { out_.clear(); }
+
+    void parse(const yaal::Buffer& buf) {
+        const char* data = buf.start();
+        std::vector<size_t> indents;
+        size_t indent = 0, spaces = 0;
+        bool at_start = true;
+        for (size_t i = 0; i < buf.len(); i++) {
+            const char c = data[i];
+            if (c == '\n') {
+                if (!at_start) out_.push_back('\n');
+                at_start = true;
+                indent = spaces = 0;
+            } else if (c == ' ') {
+                if (at_start) indent++;
+                else spaces++;
+            } else {
+                if (at_start) {
+                    while (!indents.empty() && indents.back() >= indent) indents.pop_back();
+                    out_.append(indents.size() * width_, ' ');
+                    indents.push_back(indent);
+                    at_start = false;
+                }
+                if (spaces > 0) {
+                    out_.append(spaces, ' ');
+                    spaces = 0;
+                }
+                out_.push_back(c);
+            }
+        }
+        if (!at_start) out_.push_back('\n');
+    }
+
+    size_t size() const { return out_.size(); }
+
+private:
+    size_t width_;
+    std::string out_;
+};
+
+double measure_search_throughput(const yaal::Buffer& buf, const yaal::StatementSearch& search,
+                                 int iterations, size_t& hits) {
+    hits = search.search(buf).size();
 
     auto start = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < iterations; i++) {
-        parser.reset();
-        parser.parse(buf);
+        volatile size_t n = search.search(buf).size();
+        (void)n;
     }
     auto end = std::chrono::high_resolution_clock::now();
 
@@ -195,6 +399,135 @@ double measure_reference_parser_throughput(const yaal::Buffer& buf, yaal::Refere
     return (static_cast<double>(buf.len()) * iterations) / elapsed_sec;
 }
 
+// The status quo StatementSearch replaces: a full parser pass with memmem
+// over each statement, from its bos to the end of its line
+class MemmemSearchParser : public yaal::ParserBase<MemmemSearchParser> {
+public:
+    explicit MemmemSearchParser(std::string needle) : needle_(std::move(needle)) {}
+
+    void on_buffer(const yaal::Buffer& buf) { data_ = buf.start(); }
+    void on_bod(size_t) { in_statement_ = false; }
+
+    void on_bos(size_t offset) {
+        begin_ = offset;
+        in_statement_ = true;
+    }
+
+    void on_eol(size_t offset) {
+        if (in_statement_) check(offset);
+        in_statement_ = false;
+    }
+
+    void on_eod(size_t offset) {
+        if (in_statement_) check(offset);
+    }
+
+    void reset() { hits = 0; }
+
+    uint64_t hits = 0;
+
+private:
+    void check(size_t end) {
+        if (memmem(data_ + begin_, end - begin_, needle_.data(), needle_.size())) hits++;
+    }
+
+    std::string needle_;
+    const char* data_ = nullptr;
+    size_t begin_ = 0;
+    bool in_statement_ = false;
+};
+
+// Diff throughput counts the bytes of both documents
+double measure_diff_throughput(const yaal::Buffer& a, const yaal::Buffer& b, int iterations, size_t& entries) {
+    entries = yaal::diff(a, b).size();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        volatile size_t n = yaal::diff(a, b).size();
+        (void)n;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    double elapsed_sec = std::chrono::duration<double>(end - start).count();
+    return (static_cast<double>(a.len() + b.len()) * iterations) / elapsed_sec;
+}
+
+class BlockScalarCountingParser : public yaal::BlockScalarParserBase<BlockScalarCountingParser> {
+public:
+    void on_bod(size_t) {}
+    void on_bos(size_t) { bos++; }
+    void on_eol(size_t) { eol++; }
+    void on_eod(size_t) {}
+    void on_block_scalar(size_t, size_t) { blocks++; }
+
+    static constexpr bool supports_batch = true;
+    void on_eol_batch(uint64_t count) { eol += count; }
+    void on_bos_batch(uint64_t count) { bos += count; }
+
+    void reset() { bos = eol = blocks = 0; }
+
+    uint64_t bos = 0;
+    uint64_t eol = 0;
+    uint64_t blocks = 0;
+};
+
+// Block scalars stitched back together by the consumer on top of ParserBase:
+// every block line still arrives as a bos and is dropped by indentation
+class RestitchingParser : public yaal::ParserBase<RestitchingParser> {
+public:
+    void on_buffer(const yaal::Buffer& buf) { data_ = buf.start(); }
+
+    void on_bod(size_t) {
+        line_start_ = 0;
+        in_block_ = false;
+        statement_line_ = false;
+    }
+
+    void on_bos(size_t offset) {
+        const size_t indent = offset - line_start_;
+        if (in_block_) {
+            if (indent > owner_) return;
+            blocks++;
+            in_block_ = false;
+        }
+        bos++;
+        indent_ = indent;
+        statement_line_ = true;
+    }
+
+    void on_eol(size_t offset) {
+        eol++;
+        if (statement_line_) {
+            size_t p = offset - 1;
+            while (data_[p] == ' ') p--;
+            if (data_[p] == '|' || data_[p] == '>') {
+                in_block_ = true;
+                owner_ = indent_;
+            }
+        }
+        statement_line_ = false;
+        line_start_ = offset + 1;
+    }
+
+    void on_eod(size_t) {
+        if (in_block_) blocks++;
+    }
+
+    void reset() { bos = eol = blocks = 0; }
+
+    uint64_t bos = 0;
+    uint64_t eol = 0;
+    uint64_t blocks = 0;
+
+private:
+    const char* data_ = nullptr;
+    size_t line_start_ = 0;
+    size_t indent_ = 0;
+    size_t owner_ = 0;
+    bool in_block_ = false;
+    bool statement_line_ = false;
+};
+
 void print_throughput(double bytes_per_sec) {
     double gb_per_sec = bytes_per_sec / (1024.0 * 1024.0 * 1024.0);
     std::cout << std::fixed << std::setprecision(2) << gb_per_sec << " GB/s";
@@ -202,9 +535,8 @@ void print_throughput(double bytes_per_sec) {
 
 int main(int argc, char* argv[]) {
     size_t target_size = 1024ULL * 1024 * 1024;
-    size_t avg_words_per_line = 8;
-    size_t avg_lines_per_indent = 5;
     const char* dict_path = "/usr/share/dict/words";
+    const char* corpus_path = nullptr;
     int iterations = 5;
 
     for (int i = 1; i < argc; i++) {
@@ -214,6 +546,8 @@ int main(int argc, char* argv[]) {
             iterations = std::stoi(argv[++i]);
         else if (std::strcmp(argv[i], "--dict") == 0 && i + 1 < argc)
             dict_path = argv[++i];
+        else if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc)
+            corpus_path = argv[++i];
     }
 
     std::cout << "=== YAAL Parser Benchmark ===" << std::endl << std::endl;
@@ -222,9 +556,19 @@ int main(int argc, char* argv[]) {
     auto words = load_words(dict_path);
     std::cout << "Loaded " << words.size() << " words" << std::endl << std::endl;
 
-    std::cout << "Generating " << (target_size / (1024*1024)) << " MB document..." << std::endl;
-    auto generated = generate_document(words, target_size, avg_words_per_line, avg_lines_per_indent);
-    std::cout << "Generated " << generated.data.size() << " bytes" << std::endl;
+    GeneratedDocument generated;
+    if (corpus_path) {
+        std::cout << "Loading corpus " << corpus_path << "..." << std::endl;
+        if (!load_corpus(corpus_path, generated)) {
+            std::cerr << "Cannot read " << corpus_path << " and a matching " << corpus_path << ".counts" << std::endl;
+            return 1;
+        }
+        std::cout << "Loaded " << generated.data.size() << " bytes" << std::endl;
+    } else {
+        std::cout << "Generating " << (target_size / (1024*1024)) << " MB document..." << std::endl;
+        generated = generate_corpus(words, target_size);
+        std::cout << "Generated " << generated.data.size() << " bytes" << std::endl;
+    }
     std::cout << "Expected: eol=" << generated.expected_eol << ", bos=" << generated.expected_bos << std::endl << std::endl;
 
     yaal::Buffer buf(generated.data.data(), generated.data.size());
@@ -235,10 +579,120 @@ int main(int argc, char* argv[]) {
     double nl_tp = measure_newline_throughput(generated.data.data(), generated.data.size(), iterations);
 
     yaal::CountingParser parser;
-    double parser_tp = measure_parser_throughput(buf, parser, iterations);
+    double parser_tp = measure_throughput(buf, parser, iterations);
 
     yaal::ReferenceParser ref_parser;
-    double ref_tp = measure_reference_parser_throughput(buf, ref_parser, iterations);
+    double ref_tp = measure_throughput(buf, ref_parser, iterations);
+
+    yaal::SpeculativeCountingParser spec_parser;
+    double spec_tp = measure_throughput(buf, spec_parser, iterations);
+
+    TripleCounter fanout;
+    double fanout_tp = measure_throughput(buf, fanout, iterations);
+
+    SeparatePasses separate;
+    double separate_tp = measure_throughput(buf, separate, iterations);
+
+    PerEventCountingParser per_event;
+    double per_event_tp = measure_throughput(buf, per_event, iterations);
+
+    PluginCounts virtual_handler;
+    auto counting_handler = make_counting_handler(virtual_handler);
+    VirtualDispatchParser virtual_parser(*counting_handler);
+    double virtual_tp = measure_throughput(buf, virtual_parser, iterations);
+    virtual_handler = PluginCounts{};
+    virtual_parser.parse(buf);
+
+    PluginCounts sink;
+    auto counting_sink = make_counting_sink(sink);
+    yaal::BufferedSinkParser<> sink_parser(*counting_sink);
+    double sink_tp = measure_throughput(buf, sink_parser, iterations);
+    sink = PluginCounts{};
+    sink_parser.parse(buf);
+
+    // Path queries keyed on the document's first unindented statement
+    const auto& doc = generated.data;
+    size_t root = 0;
+    while (root < doc.size() && (doc[root] == ' ' || doc[root] == '\n')) {
+        root = std::find(doc.begin() + root, doc.end(), '\n') - doc.begin() + 1;
+    }
+    root = std::min(root, doc.size());
+    std::string first_key(doc.begin() + root,
+                          std::find_if(doc.begin() + root, doc.end(), [](char c) { return c == ' ' || c == '\n'; }));
+    yaal::PathQuery selective_query({first_key + "/*", "*/" + first_key});
+    double query_tp = measure_throughput(buf, selective_query, iterations);
+    yaal::PathQuery miss_query({"no/such/path"});
+    double query_miss_tp = measure_throughput(buf, miss_query, iterations);
+
+    // Statement search: a needle absent from the corpus and a dictionary word
+    yaal::StatementSearch rare_search("zqxj@yaal");
+    size_t rare_hits = 0;
+    double rare_search_tp = measure_search_throughput(buf, rare_search, iterations, rare_hits);
+    yaal::StatementSearch word_search(words[words.size() / 2]);
+    size_t word_hits = 0;
+    double word_search_tp = measure_search_throughput(buf, word_search, iterations, word_hits);
+    MemmemSearchParser rare_memmem(rare_search.needle());
+    double rare_memmem_tp = measure_throughput(buf, rare_memmem, iterations);
+    MemmemSearchParser word_memmem(word_search.needle());
+    double word_memmem_tp = measure_throughput(buf, word_memmem, iterations);
+
+    // Diff against a copy with ~1000 statements edited in place
+    std::vector<char> edited = generated.data;
+    FastRandom edit_rng(7);
+    for (int i = 0; i < 1000; i++) {
+        size_t at = edit_rng.next(edited.size());
+        if (edited[at] != ' ' && edited[at] != '\n') edited[at] = '#';
+    }
+    yaal::Buffer edited_buf(edited.data(), edited.size());
+    size_t diff_entries = 0;
+    double diff_tp = measure_diff_throughput(buf, edited_buf, iterations, diff_entries);
+
+    // Block scalars: the plain corpus has no markers, the block corpus is
+    // mostly block lines
+    BlockScalarCountingParser block_parser;
+    double block_plain_tp = measure_throughput(buf, block_parser, iterations);
+    auto block_doc = generate_block_document(generated.data.size() / 4);
+    yaal::Buffer block_buf(block_doc.data.data(), block_doc.data.size());
+    yaal::CountingParser block_scan;
+    double block_scan_tp = measure_throughput(block_buf, block_scan, iterations);
+    RestitchingParser restitch;
+    double restitch_tp = measure_throughput(block_buf, restitch, iterations);
+    BlockScalarCountingParser block_scalar;
+    double block_scalar_tp = measure_throughput(block_buf, block_scalar, iterations);
+
+    // Normalizing round trips: the corpus is indented 4 spaces per level, so
+    // width 2 rewrites every indented line and width 4 passes it through
+    NormalizeRoundTrip normalize_rewrite(generated.data.size() + 64, 2);
+    double normalize_rewrite_tp = measure_throughput(buf, normalize_rewrite, iterations);
+    NormalizeRoundTrip normalize_pass(generated.data.size() + 64, 4);
+    double normalize_pass_tp = measure_throughput(buf, normalize_pass, iterations);
+    BytewiseNormalizer bytewise(2);
+    double bytewise_tp = measure_throughput(buf, bytewise, iterations);
+
+    // JSON: streamed through a 1 MB buffer into a sink, or grown in memory
+    JsonRoundTrip json_sink(generated.data.size() * 2 + 64);
+    double json_sink_tp = measure_throughput(buf, json_sink, iterations);
+    yaal::JsonTranscoder json_growable;
+    double json_growable_tp = measure_throughput(buf, json_growable, iterations);
+    yaal::JsonOptions json_options;
+    json_options.count_duplicate_keys = true;
+    yaal::JsonTranscoder json_keys(json_options);
+    double json_keys_tp = measure_throughput(buf, json_keys, iterations);
+
+    // Quoted strings: the main corpus has none, the quoted corpus has
+    // multi-line string values
+    yaal::QuotedCountingParser quoted_plain;
+    double quoted_plain_tp = measure_throughput(buf, quoted_plain, iterations);
+    auto quoted_doc = generate_quoted_document(words, generated.data.size() / 4);
+    yaal::Buffer quoted_buf(quoted_doc.data.data(), quoted_doc.data.size());
+    yaal::CountingParser quoted_scan;
+    double quoted_scan_tp = measure_throughput(quoted_buf, quoted_scan, iterations);
+    yaal::QuotedCountingParser quoted_parser;
+    double quoted_tp = measure_throughput(quoted_buf, quoted_parser, iterations);
+    quoted_plain.reset();
+    quoted_plain.parse(buf);
+    quoted_parser.reset();
+    quoted_parser.parse(quoted_buf);
 
     parser.reset();
     parser.parse(buf);
@@ -271,6 +725,144 @@ int main(int argc, char* argv[]) {
     std::cout << "  -> Uses 192-byte unrolled loop, local accumulators, and popcnt." << std::endl;
     std::cout << "  -> BASELINE: Reference implementation showing achievable performance." << std::endl << std::endl;
 
+    std::cout << "SpeculativeCountingParser:";
+    print_throughput(spec_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (spec_tp / read_tp * 100) << "%)" << std::endl;
+    std::cout << "  -> Carry-select kernel (speculative_parser.hpp): 512-byte blocks, bos masks for both" << std::endl;
+    std::cout << "     incoming carries, true carries resolved with one carry-lookahead add." << std::endl << std::endl;
+
+    std::cout << "Fanout (3 consumers):     ";
+    print_throughput(fanout_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (fanout_tp / read_tp * 100) << "%)" << std::endl;
+    std::cout << "  -> Fanout<CountingParser x3> (fanout.hpp): one scan forwarding every event to 3 handlers." << std::endl << std::endl;
+
+    std::cout << "Separate passes (3x):     ";
+    print_throughput(separate_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (separate_tp / read_tp * 100) << "%)" << std::endl;
+    std::cout << "  -> The same 3 CountingParsers, each doing its own pass over the document." << std::endl << std::endl;
+
+    std::cout << "Per-event CRTP:           ";
+    print_throughput(per_event_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (per_event_tp / read_tp * 100) << "%)" << std::endl;
+    std::cout << "  -> ParserBase consumer without batch support: one inlined call per event." << std::endl << std::endl;
+
+    std::cout << "Per-event virtual:        ";
+    print_throughput(virtual_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (virtual_tp / read_tp * 100) << "%)" << std::endl;
+    std::cout << "  -> One virtual call per event into a handler from another translation unit." << std::endl << std::endl;
+
+    std::cout << "Buffered EventSink:       ";
+    print_throughput(sink_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (sink_tp / read_tp * 100) << "%)" << std::endl;
+    std::cout << "  -> BufferedSinkParser (event_sink.hpp): one virtual call per 1024 events, same plugin TU." << std::endl << std::endl;
+
+    std::cout << "PathQuery (2 queries):    ";
+    print_throughput(query_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (query_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> PathQuery (path_query.hpp) running \"" << first_key << "/*\" and \"*/" << first_key << "\" in one pass, "
+              << selective_query.matches().size() << " matches." << std::endl << std::endl;
+
+    std::cout << "PathQuery (no match):     ";
+    print_throughput(query_miss_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (query_miss_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> Non-matching subtrees are dropped from the masks before any event is emitted." << std::endl << std::endl;
+
+    std::cout << "Parser + memmem (rare):   ";
+    print_throughput(rare_memmem_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (rare_memmem_tp / nl_tp * 100) << "% of newline scan)" << std::endl;
+    std::cout << "  -> Baseline: ParserBase pass with memmem over every statement." << std::endl << std::endl;
+
+    std::cout << "StatementSearch (rare):   ";
+    print_throughput(rare_search_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (rare_search_tp / nl_tp * 100) << "% of newline scan, "
+              << std::setprecision(2) << (rare_search_tp / rare_memmem_tp) << "x parser + memmem)" << std::endl;
+    std::cout << "  -> StatementSearch (statement_search.hpp) for \"" << rare_search.needle() << "\", "
+              << rare_hits << " statements." << std::endl;
+    std::cout << "  -> First/last needle byte prefilter on the parser's loaded chunks, hits mapped via bos/eol masks." << std::endl << std::endl;
+
+    std::cout << "Parser + memmem (word):   ";
+    print_throughput(word_memmem_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (word_memmem_tp / nl_tp * 100) << "% of newline scan)" << std::endl << std::endl;
+
+    std::cout << "StatementSearch (word):   ";
+    print_throughput(word_search_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (word_search_tp / nl_tp * 100) << "% of newline scan, "
+              << std::setprecision(2) << (word_search_tp / word_memmem_tp) << "x parser + memmem)" << std::endl;
+    std::cout << "  -> Dictionary word \"" << word_search.needle() << "\", " << word_hits << " statements." << std::endl;
+    std::cout << "  -> Short of newline-scan speed: the bos/eol masks and the first/last byte compares add" << std::endl
+              << "     work per chunk, and frequent first/last byte pairs add memcmp verifies." << std::endl << std::endl;
+
+    std::cout << "Structural diff:          ";
+    print_throughput(diff_tp);
+    std::cout << " (input of both documents)" << std::endl;
+    std::cout << "  -> yaal::diff (diff.hpp): per-statement hashes from two parallel scans, Myers alignment, "
+              << diff_entries << " entries." << std::endl << std::endl;
+
+    std::cout << "BlockScalar (no blocks):  ";
+    print_throughput(block_plain_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (block_plain_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> BlockScalarParserBase (block_scalar.hpp) on the main corpus, which has no markers." << std::endl << std::endl;
+
+    std::cout << "Block corpus (" << (block_doc.data.size() / (1024 * 1024)) << " MB, "
+              << block_scalar.blocks << " blocks):" << std::endl;
+    std::cout << "  CountingParser:         ";
+    print_throughput(block_scan_tp);
+    std::cout << " (every block line is a statement)" << std::endl;
+    std::cout << "  Restitched on ParserBase:";
+    print_throughput(restitch_tp);
+    std::cout << " (consumer drops block lines by indentation)" << std::endl;
+    std::cout << "  BlockScalarParserBase:  ";
+    print_throughput(block_scalar_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (block_scalar_tp / restitch_tp * 100) << "% of restitched)" << std::endl;
+    std::cout << "  -> Block lines suppressed in the kernel, one span per block." << std::endl << std::endl;
+
+    std::cout << "Writer (width 2):         ";
+    print_throughput(normalize_rewrite_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (normalize_rewrite_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> Parse + normalize (writer.hpp) re-indenting every nested line into a memory sink." << std::endl << std::endl;
+
+    std::cout << "Writer (width 4):         ";
+    print_throughput(normalize_pass_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (normalize_pass_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> Already normalized input: unchanged lines are passed through as bulk runs." << std::endl << std::endl;
+
+    std::cout << "Bytewise normalize:       ";
+    print_throughput(bytewise_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (bytewise_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> The width 2 normalization one byte at a time into a std::string." << std::endl << std::endl;
+
+    std::cout << "JSON (sink):              ";
+    print_throughput(json_sink_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (json_sink_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> JsonTranscoder (json_transcoder.hpp) streaming " << json_sink.size() << " bytes of JSON, peak "
+              << json_sink.memory_footprint() / 1024 << " KB held by the transcoder." << std::endl << std::endl;
+
+    std::cout << "JSON (growable buffer):   ";
+    print_throughput(json_growable_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (json_growable_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> Whole output kept in memory, peak " << json_growable.memory_footprint() / 1024
+              << " KB; parse-only holds no output." << std::endl << std::endl;
+
+    std::cout << "JSON (duplicate keys):    ";
+    print_throughput(json_keys_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (json_keys_tp / json_growable_tp * 100) << "% of growable)" << std::endl;
+    std::cout << "  -> count_duplicate_keys keeps the keys of every open object, peak with the output "
+              << json_keys.memory_footprint() / 1024 << " KB, " << json_keys.duplicate_keys() << " duplicates." << std::endl << std::endl;
+
+    std::cout << "Quoted (no quotes):       ";
+    print_throughput(quoted_plain_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (quoted_plain_tp / parser_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> QuotedParserBase (quoted_parser.hpp) on the main corpus, which has no quotes." << std::endl << std::endl;
+
+    std::cout << "Quoted corpus (" << (quoted_doc.data.size() / (1024 * 1024)) << " MB, 4-line strings):" << std::endl;
+    std::cout << "  CountingParser:         ";
+    print_throughput(quoted_scan_tp);
+    std::cout << " (splits every string at its newlines)" << std::endl;
+    std::cout << "  QuotedCountingParser:   ";
+    print_throughput(quoted_tp);
+    std::cout << " (" << std::fixed << std::setprecision(1) << (quoted_tp / quoted_scan_tp * 100) << "% of CountingParser)" << std::endl;
+    std::cout << "  -> Prefix-XOR quote masks (CLMUL) with backslash escapes, quoted newlines and spaces masked out." << std::endl << std::endl;
+
     std::cout << "Verification against generator ground truth:" << std::endl;
     bool all_pass = true;
 
@@ -292,6 +884,110 @@ int main(int argc, char* argv[]) {
         all_pass = false;
     }
 
+    std::cout << "  Speculative:            eol=" << spec_parser.counts().eol << " bos=" << spec_parser.counts().bos;
+    if (spec_parser.counts().eol == generated.expected_eol && spec_parser.counts().bos == generated.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  Fanout (3 consumers):   eol=" << fanout.get<2>().counts().eol << " bos=" << fanout.get<2>().counts().bos;
+    if (fanout.get<2>().counts().eol == generated.expected_eol && fanout.get<2>().counts().bos == generated.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  Per-event virtual:      eol=" << virtual_handler.eol << " bos=" << virtual_handler.bos;
+    if (virtual_handler.eol == generated.expected_eol && virtual_handler.bos == generated.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  Buffered EventSink:     eol=" << sink.eol << " bos=" << sink.bos;
+    if (sink.eol == generated.expected_eol && sink.bos == generated.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  BlockScalar (no blocks):eol=" << block_parser.eol << " bos=" << block_parser.bos;
+    if (block_parser.eol == generated.expected_eol && block_parser.bos == generated.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  Block corpus (expected):eol=" << block_doc.expected_eol << " bos=" << block_doc.expected_bos << std::endl;
+
+    std::cout << "  BlockScalarParserBase:  eol=" << block_scalar.eol << " bos=" << block_scalar.bos;
+    if (block_scalar.eol == block_doc.expected_eol && block_scalar.bos == block_doc.expected_bos &&
+        block_scalar.blocks == restitch.blocks) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  Restitched:             eol=" << restitch.eol << " bos=" << restitch.bos;
+    if (restitch.eol == block_doc.expected_eol && restitch.bos == block_doc.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  Quoted (no quotes):     eol=" << quoted_plain.counts().eol << " bos=" << quoted_plain.counts().bos;
+    if (quoted_plain.counts().eol == generated.expected_eol && quoted_plain.counts().bos == generated.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  Quoted corpus (expected):eol=" << quoted_doc.expected_eol << " bos=" << quoted_doc.expected_bos << std::endl;
+
+    std::cout << "  QuotedCountingParser:   eol=" << quoted_parser.counts().eol << " bos=" << quoted_parser.counts().bos;
+    if (quoted_parser.counts().eol == quoted_doc.expected_eol && quoted_parser.counts().bos == quoted_doc.expected_bos) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    // Only the built-in corpus is already in width-4 normal form
+    std::cout << "  Writer (width 2/4):     bytes=" << normalize_rewrite.size() << "/" << normalize_pass.size();
+    if (normalize_rewrite.size() == bytewise.size() && (corpus_path || normalize_pass.size() == generated.data.size())) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  JSON (sink/growable):   bytes=" << json_sink.size() << "/" << json_growable.output_size();
+    if (json_sink.size() == json_growable.output_size() && json_keys.output_size() == json_growable.output_size() &&
+        std::memcmp(json_sink.data(), json_growable.output(), json_sink.size()) == 0 &&
+        json_growable.output()[0] == '{' && json_growable.output()[json_growable.output_size() - 1] == '}') {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
+    std::cout << "  StatementSearch:        hits=" << rare_hits << "/" << word_hits;
+    if (rare_hits == rare_memmem.hits && word_hits == word_memmem.hits) {
+        std::cout << " [PASS]" << std::endl;
+    } else {
+        std::cout << " [FAIL]" << std::endl;
+        all_pass = false;
+    }
+
     std::cout << std::endl << "Overall: " << (all_pass ? "ALL PASS" : "SOME FAILED") << std::endl;
 
     return 0;
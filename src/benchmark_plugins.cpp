@@ -0,0 +1,46 @@
+#include "benchmark_plugins.hpp"
+
+namespace {
+
+class CountingVirtualHandler : public VirtualEventHandler {
+public:
+    explicit CountingVirtualHandler(PluginCounts& counts) : counts_(&counts) {}
+
+    void on_event(yaal::EventKind kind, size_t) override {
+        if (kind == yaal::EventKind::bos) counts_->bos++;
+        else if (kind == yaal::EventKind::eol) counts_->eol++;
+    }
+
+private:
+    PluginCounts* counts_;
+};
+
+// Batched runtime sink: one virtual call per batch
+class CountingSink : public yaal::EventSink {
+public:
+    explicit CountingSink(PluginCounts& counts) : counts_(&counts) {}
+
+    void on_events(const yaal::Event* events, size_t count) override {
+        uint64_t bos = 0;
+        uint64_t eol = 0;
+        for (size_t i = 0; i < count; i++) {
+            bos += events[i].kind() == yaal::EventKind::bos;
+            eol += events[i].kind() == yaal::EventKind::eol;
+        }
+        counts_->bos += bos;
+        counts_->eol += eol;
+    }
+
+private:
+    PluginCounts* counts_;
+};
+
+} // namespace
+
+std::unique_ptr<VirtualEventHandler> make_counting_handler(PluginCounts& counts) {
+    return std::make_unique<CountingVirtualHandler>(counts);
+}
+
+std::unique_ptr<yaal::EventSink> make_counting_sink(PluginCounts& counts) {
+    return std::make_unique<CountingSink>(counts);
+}
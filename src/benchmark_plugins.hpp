@@ -0,0 +1,26 @@
+#pragma once
+
+#include "yaal/event_sink.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Runtime consumers for the dispatch benchmarks. They are defined in their
+// own translation unit, as a plugin would be, so the benchmark cannot see
+// the concrete types and every call stays an indirect call.
+
+// Per-event virtual dispatch, the naive plugin interface
+class VirtualEventHandler {
+public:
+    virtual ~VirtualEventHandler() = default;
+    virtual void on_event(yaal::EventKind kind, size_t offset) = 0;
+};
+
+struct PluginCounts {
+    uint64_t bos = 0;
+    uint64_t eol = 0;
+};
+
+// Both count bos and eol events into counts
+std::unique_ptr<VirtualEventHandler> make_counting_handler(PluginCounts& counts);
+std::unique_ptr<yaal::EventSink> make_counting_sink(PluginCounts& counts);
@@ -0,0 +1,173 @@
+#include "yaal/corpus_generator.hpp"
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes a synthetic YAAL corpus and, next to it, a sidecar <output>.counts
+// with its exact eol/bos/eos counts (see CorpusCounts::write).
+
+static void usage() {
+    std::cerr << "usage: yaal_gen --output FILE [options]\n"
+                 "  --size MB                 corpus size (default 1024)\n"
+                 "  --seed N                  (default 42)\n"
+                 "  --threads N               (default: hardware threads)\n"
+                 "  --dict FILE               take words from a dictionary\n"
+                 "  --line-lengths KIND       fixed, uniform or exponential (default uniform)\n"
+                 "  --mean-line N             mean body length in bytes (default 48)\n"
+                 "  --max-line N              longest body in bytes (default 256)\n"
+                 "  --blank-ratio R           share of blank lines (default 0.05)\n"
+                 "  --comment-ratio R         share of \"# \" statements (default 0.02)\n"
+                 "  --utf8-ratio R            share of UTF-8 words (default 0)\n"
+                 "  --indent-width N          spaces per level (default 2)\n"
+                 "  --max-depth N             deepest level (default 8)\n"
+                 "  --lines-per-level N       mean lines at one depth (default 5)\n"
+                 "  --no-trailing-newline     drop the final '\\n'\n";
+}
+
+// A whole decimal number in [min, max]: no sign, spaces or trailing bytes.
+// Anything else throws std::invalid_argument or std::out_of_range.
+static uint64_t parse_count(const char* text, uint64_t min, uint64_t max = UINT64_MAX) {
+    size_t pos = 0;
+    const uint64_t value = std::isdigit(static_cast<unsigned char>(text[0])) ? std::stoull(text, &pos) : 0;
+    if (pos == 0 || text[pos] != '\0') throw std::invalid_argument(text);
+    if (value < min || value > max) throw std::out_of_range(text);
+    return value;
+}
+
+// A share in [0, 1], written as a plain decimal
+static double parse_ratio(const char* text) {
+    size_t pos = 0;
+    const bool number = std::isdigit(static_cast<unsigned char>(text[0])) || text[0] == '.';
+    const double value = number ? std::stod(text, &pos) : 0;
+    if (pos == 0 || text[pos] != '\0') throw std::invalid_argument(text);
+    if (!(value >= 0 && value <= 1)) throw std::out_of_range(text);
+    return value;
+}
+
+static std::vector<std::string> load_words(const char* path) {
+    std::vector<std::string> words;
+    std::ifstream file(path);
+    std::string word;
+    while (std::getline(file, word)) {
+        if (!word.empty()) words.push_back(word);
+    }
+    return words;
+}
+
+int main(int argc, char* argv[]) {
+    const char* output = nullptr;
+    const char* dict_path = nullptr;
+    size_t target_size = 1024ULL * 1024 * 1024;
+    uint64_t seed = 42;
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    yaal::CorpusShape shape;
+
+    // A malformed or out-of-range number is a usage error, as is a count of
+    // zero except for --seed and --max-depth. Lines stay within a segment
+    // and indentation within a megabyte.
+    constexpr uint64_t max_line = yaal::CorpusGenerator::segment_size;
+    constexpr uint64_t max_level = 1024;
+    try {
+        for (int i = 1; i < argc; i++) {
+            const bool has_value = i + 1 < argc;
+            if (std::strcmp(argv[i], "--output") == 0 && has_value)
+                output = argv[++i];
+            else if (std::strcmp(argv[i], "--size") == 0 && has_value)
+                target_size = parse_count(argv[++i], 1, SIZE_MAX / (1024 * 1024)) * 1024 * 1024;
+            else if (std::strcmp(argv[i], "--seed") == 0 && has_value)
+                seed = parse_count(argv[++i], 0);
+            else if (std::strcmp(argv[i], "--threads") == 0 && has_value)
+                threads = static_cast<unsigned>(parse_count(argv[++i], 1, UINT32_MAX));
+            else if (std::strcmp(argv[i], "--dict") == 0 && has_value)
+                dict_path = argv[++i];
+            else if (std::strcmp(argv[i], "--line-lengths") == 0 && has_value) {
+                const std::string kind = argv[++i];
+                if (kind == "fixed") shape.line_lengths = yaal::LineLengths::fixed;
+                else if (kind == "uniform") shape.line_lengths = yaal::LineLengths::uniform;
+                else if (kind == "exponential") shape.line_lengths = yaal::LineLengths::exponential;
+                else {
+                    usage();
+                    return 1;
+                }
+            }
+            else if (std::strcmp(argv[i], "--mean-line") == 0 && has_value)
+                shape.mean_line_length = parse_count(argv[++i], 1, max_line);
+            else if (std::strcmp(argv[i], "--max-line") == 0 && has_value)
+                shape.max_line_length = parse_count(argv[++i], 1, max_line);
+            else if (std::strcmp(argv[i], "--blank-ratio") == 0 && has_value)
+                shape.blank_ratio = parse_ratio(argv[++i]);
+            else if (std::strcmp(argv[i], "--comment-ratio") == 0 && has_value)
+                shape.comment_ratio = parse_ratio(argv[++i]);
+            else if (std::strcmp(argv[i], "--utf8-ratio") == 0 && has_value)
+                shape.utf8_ratio = parse_ratio(argv[++i]);
+            else if (std::strcmp(argv[i], "--indent-width") == 0 && has_value)
+                shape.indent_width = parse_count(argv[++i], 1, max_level);
+            else if (std::strcmp(argv[i], "--max-depth") == 0 && has_value)
+                shape.max_depth = parse_count(argv[++i], 0, max_level);
+            else if (std::strcmp(argv[i], "--lines-per-level") == 0 && has_value)
+                shape.lines_per_level = parse_count(argv[++i], 1);
+            else if (std::strcmp(argv[i], "--no-trailing-newline") == 0)
+                shape.trailing_newline = false;
+            else {
+                usage();
+                return 1;
+            }
+        }
+    } catch (const std::invalid_argument&) {
+        usage();
+        return 1;
+    } catch (const std::out_of_range&) {
+        usage();
+        return 1;
+    }
+    if (!output) {
+        usage();
+        return 1;
+    }
+
+    std::FILE* file = std::fopen(output, "wb");
+    if (!file) {
+        std::perror(output);
+        return 1;
+    }
+
+    std::vector<std::string> words;
+    if (dict_path) words = load_words(dict_path);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    yaal::CorpusGenerator generator(shape, seed, words);
+    bool ok = true;
+    const yaal::CorpusCounts counts = generator.generate(target_size, threads, [&](const char* data, size_t len) {
+        ok = ok && std::fwrite(data, 1, len, file) == len;
+    });
+    ok = std::fclose(file) == 0 && ok;
+    auto end = std::chrono::high_resolution_clock::now();
+    if (!ok) {
+        std::perror(output);
+        return 1;
+    }
+
+    const std::string sidecar = std::string(output) + ".counts";
+    std::ofstream counts_file(sidecar);
+    counts.write(counts_file);
+    counts_file << "seed=" << seed << "\n";
+    if (!counts_file) {
+        std::perror(sidecar.c_str());
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << "Wrote " << counts.bytes << " bytes to " << output << " in " << std::fixed << std::setprecision(2)
+              << seconds << " s (" << (counts.bytes / seconds / 1e9) << " GB/s, " << threads << " threads)" << std::endl;
+    std::cout << "eol=" << counts.eol << " bos=" << counts.bos << " eos=" << counts.eos << " -> " << sidecar << std::endl;
+    return 0;
+}
@@ -1,9 +1,23 @@
 #include <boost/ut.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
 #include <string>
 #include <vector>
 
+#include "yaal/block_scalar.hpp"
+#include "yaal/corpus_generator.hpp"
 #include "yaal/counting_parser.hpp"
+#include "yaal/diff.hpp"
+#include "yaal/event_sink.hpp"
+#include "yaal/fanout.hpp"
+#include "yaal/json_transcoder.hpp"
+#include "yaal/path_query.hpp"
+#include "yaal/quoted_parser.hpp"
 #include "yaal/reference_parser.hpp"
+#include "yaal/speculative_parser.hpp"
+#include "yaal/statement_search.hpp"
+#include "yaal/writer.hpp"
 
 using namespace boost::ut;
 
@@ -27,6 +41,62 @@ ParseResult parse_with_reference(const std::string& input) {
     return {parser.counts().bos, parser.counts().eol};
 }
 
+// Records every event offset (no batch support, so the per-event path is used)
+class EventRecorder : public yaal::ParserBase<EventRecorder> {
+public:
+    void on_bod(size_t offset) { bod.push_back(offset); }
+    void on_bos(size_t offset) { bos.push_back(offset); }
+    void on_eol(size_t offset) { eol.push_back(offset); }
+    void on_eod(size_t offset) { eod.push_back(offset); }
+
+    void reset() { *this = EventRecorder{}; }
+
+    std::vector<size_t> bod;
+    std::vector<size_t> bos;
+    std::vector<size_t> eol;
+    std::vector<size_t> eod;
+};
+
+// Deterministic test document: indented lines, blank lines and runs of
+// spaces, long enough to go through every unrolled loop of the kernels.
+std::string make_document(size_t lines) {
+    std::string doc;
+    for (size_t i = 0; i < lines; i++) {
+        doc += std::string((i % 5) * 2, ' ');
+        if (i % 7 == 3) {
+            doc += "   \n";
+            continue;
+        }
+        doc += "line";
+        doc += std::to_string(i);
+        doc += std::string(i % 3, ' ');
+        doc += "value\n";
+    }
+    return doc;
+}
+
+// Seeded LCG shared by the random-document tests
+struct Lcg {
+    uint64_t state;
+    uint64_t operator()() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return state >> 33;
+    }
+};
+
+// Builds random documents with build(next) and returns how many
+// check(input) rejects
+template<typename Build, typename Check>
+size_t random_document_failures(uint64_t seed, int documents, Build build, Check check) {
+    Lcg next{seed};
+    size_t failures = 0;
+    for (int doc = 0; doc < documents; doc++) {
+        const std::string input = build(next);
+        if (!check(input)) failures++;
+    }
+    return failures;
+}
+
 suite parser_tests = [] {
     "basic_single_line"_test = [] {
         std::string input = "hello\n";
@@ -199,6 +269,1640 @@ suite parser_tests = [] {
     };
 };
 
+// Records bos and eol offsets like EventRecorder, through a mask filter
+// that drops the events of every odd 64-byte block
+class OddBlockFilter : public yaal::ParserBase<OddBlockFilter> {
+public:
+    void on_bod(size_t) {}
+    void on_bos(size_t offset) { bos.push_back(offset); }
+    void on_eol(size_t offset) { eol.push_back(offset); }
+    void on_eod(size_t) {}
+
+    static constexpr bool supports_event_filter = true;
+    void filter_events(uint64_t& nl_mask, uint64_t& bos_mask, size_t base_pos) {
+        if (base_pos / 64 % 2) nl_mask = bos_mask = 0;
+    }
+
+    std::vector<size_t> bos;
+    std::vector<size_t> eol;
+};
+
+bool same_matches(const std::vector<yaal::PathMatch>& a, const std::vector<yaal::PathMatch>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const yaal::PathMatch& x, const yaal::PathMatch& y) {
+        return x.query == y.query && x.begin == y.begin && x.end == y.end;
+    });
+}
+
+suite fanout_tests = [] {
+    "fanout_counting_matches_single_pass"_test = [] {
+        std::string input = make_document(200);
+        yaal::Buffer buf(input.data(), input.size());
+
+        yaal::CountingParser single;
+        single.parse(buf);
+
+        yaal::Fanout<yaal::CountingParser, yaal::CountingParser> fanout;
+        static_assert(decltype(fanout)::supports_batch, "all handlers batch");
+        fanout.parse(buf);
+
+        expect(eq(fanout.get<0>().counts().bos, single.counts().bos));
+        expect(eq(fanout.get<0>().counts().eol, single.counts().eol));
+        expect(eq(fanout.get<1>().counts().bos, single.counts().bos));
+        expect(eq(fanout.get<1>().counts().eol, single.counts().eol));
+        expect(eq(fanout.get<1>().counts().bod, 1u));
+        expect(eq(fanout.get<1>().counts().eod, 1u));
+    };
+
+    "fanout_mixed_handlers_use_per_event_path"_test = [] {
+        std::string input = make_document(200);
+        yaal::Buffer buf(input.data(), input.size());
+
+        EventRecorder single;
+        single.parse(buf);
+
+        yaal::CountingParser counting;
+        counting.parse(buf);
+
+        yaal::Fanout<yaal::CountingParser, EventRecorder> fanout;
+        static_assert(!decltype(fanout)::supports_batch, "recorder has no batch support");
+        fanout.parse(buf);
+
+        const auto& recorder = fanout.get<EventRecorder>();
+        expect(recorder.bos == single.bos) << "BOS offsets differ";
+        expect(recorder.eol == single.eol) << "EOL offsets differ";
+        expect(recorder.eod == single.eod) << "EOD offset differs";
+        expect(eq(fanout.get<yaal::CountingParser>().counts().bos, counting.counts().bos));
+        expect(eq(fanout.get<yaal::CountingParser>().counts().eol, counting.counts().eol));
+    };
+
+    "fanout_forwards_buffer_and_event_filter"_test = [] {
+        // A subtree PathQuery skips at the mask level, then ordinary lines
+        std::string input = "noise\n";
+        for (int i = 0; i < 100; i++) input += "  target: deep\n";
+        input += "target: top\n" + make_document(300);
+        yaal::Buffer buf(input.data(), input.size());
+
+        OddBlockFilter odd;
+        odd.parse(buf);
+        yaal::PathQuery top({"target"});
+        top.parse(buf);
+        yaal::PathQuery deep({"noise/target", "line15value"});
+        deep.parse(buf);
+
+        // Each handler sees its own filtered events, not the union
+        yaal::Fanout<OddBlockFilter, yaal::PathQuery, yaal::PathQuery> filtered(
+            OddBlockFilter{}, yaal::PathQuery({"target"}), yaal::PathQuery({"noise/target", "line15value"}));
+        static_assert(decltype(filtered)::supports_event_filter, "every handler filters");
+        filtered.parse(buf);
+        expect(filtered.get<0>().bos == odd.bos);
+        expect(filtered.get<0>().eol == odd.eol);
+        expect(same_matches(filtered.get<1>().matches(), top.matches()));
+        expect(same_matches(filtered.get<2>().matches(), deep.matches()));
+        expect(eq(filtered.get<2>().matches().size(), size_t{101}));
+
+        // Buffer-reading handlers next to one without a filter
+        yaal::JsonTranscoder json;
+        json.parse(buf);
+        yaal::Fanout<yaal::CountingParser, yaal::PathQuery, yaal::JsonTranscoder> mixed(
+            yaal::CountingParser{}, yaal::PathQuery({"target"}), yaal::JsonTranscoder{});
+        static_assert(!decltype(mixed)::supports_event_filter, "CountingParser has no filter");
+        mixed.parse(buf);
+        expect(same_matches(mixed.get<1>().matches(), top.matches()));
+        expect(std::string(mixed.get<2>().output(), mixed.get<2>().output_size()) ==
+               std::string(json.output(), json.output_size()));
+    };
+
+    "fanout_reset_clears_all_handlers"_test = [] {
+        std::string input = "a\n b\n";
+        yaal::Buffer buf(input.data(), input.size());
+
+        yaal::Fanout<yaal::CountingParser, EventRecorder> fanout;
+        fanout.parse(buf);
+        fanout.reset();
+
+        expect(eq(fanout.get<0>().counts().bos, 0u));
+        expect(fanout.get<1>().bos.empty());
+    };
+};
+
+// Rebuilds per-kind offset lists from buffered batches
+class RecordingSink : public yaal::EventSink {
+public:
+    void on_events(const yaal::Event* events, size_t count) override {
+        batches++;
+        if (count > largest_batch) largest_batch = count;
+        for (size_t i = 0; i < count; i++) {
+            switch (events[i].kind()) {
+                case yaal::EventKind::bod: bod.push_back(events[i].offset()); break;
+                case yaal::EventKind::bos: bos.push_back(events[i].offset()); break;
+                case yaal::EventKind::eol: eol.push_back(events[i].offset()); break;
+                case yaal::EventKind::eod: eod.push_back(events[i].offset()); break;
+            }
+        }
+    }
+
+    size_t batches = 0;
+    size_t largest_batch = 0;
+    std::vector<size_t> bod;
+    std::vector<size_t> bos;
+    std::vector<size_t> eol;
+    std::vector<size_t> eod;
+};
+
+suite event_sink_tests = [] {
+    "sink_receives_all_events_in_batches"_test = [] {
+        std::string input = make_document(2000);
+        yaal::Buffer buf(input.data(), input.size());
+
+        EventRecorder direct;
+        direct.parse(buf);
+
+        RecordingSink sink;
+        yaal::BufferedSinkParser<> parser(sink);
+        parser.parse(buf);
+
+        expect(sink.bod == direct.bod) << "BOD mismatch";
+        expect(sink.bos == direct.bos) << "BOS offsets differ";
+        expect(sink.eol == direct.eol) << "EOL offsets differ";
+        expect(sink.eod == direct.eod) << "EOD mismatch";
+        expect(eq(sink.largest_batch, size_t{1024}));
+        expect(sink.batches > 1u);
+    };
+
+    "sink_small_batches_split_exactly"_test = [] {
+        std::string input = "a\nb\nc\n";  // bod + 3 bos + 3 eol + eod = 8 events
+        yaal::Buffer buf(input.data(), input.size());
+
+        RecordingSink sink;
+        yaal::BufferedSinkParser<4> parser(sink);
+        parser.parse(buf);
+
+        expect(eq(sink.batches, size_t{2}));
+        expect(eq(sink.largest_batch, size_t{4}));
+        expect(eq(sink.bos.size(), size_t{3}));
+        expect(eq(sink.eol.size(), size_t{3}));
+    };
+
+    "sink_event_packs_kind_and_offset"_test = [] {
+        const uint64_t offsets[] = {0, 1, 12345, yaal::Event::offset_mask};
+        for (auto kind : {yaal::EventKind::bod, yaal::EventKind::bos, yaal::EventKind::eol, yaal::EventKind::eod}) {
+            for (uint64_t offset : offsets) {
+                yaal::Event event(kind, offset);
+                expect(event.kind() == kind);
+                expect(eq(event.offset(), offset));
+            }
+        }
+    };
+
+    "sink_empty_document"_test = [] {
+        RecordingSink sink;
+        yaal::BufferedSinkParser<> parser(sink);
+        parser.parse(yaal::Buffer("", 0));
+
+        expect(eq(sink.batches, size_t{1}));
+        expect(eq(sink.bod.size(), size_t{1}));
+        expect(eq(sink.eod.size(), size_t{1}));
+    };
+};
+
+std::vector<std::string> run_query(const std::vector<std::string>& paths, const std::string& input,
+                                   std::vector<size_t>* queries = nullptr) {
+    yaal::PathQuery query(paths);
+    query.parse(yaal::Buffer(input.data(), input.size()));
+    std::vector<std::string> values;
+    for (const auto& m : query.matches()) {
+        values.push_back(input.substr(m.begin, m.end - m.begin));
+        if (queries) queries->push_back(m.query);
+    }
+    return values;
+}
+
+const std::string path_query_doc =
+    "server:\n"
+    "  name: a\n"
+    "  limits:\n"
+    "    max_conn: 100\n"
+    "    other: 1\n"
+    "  misc:\n"
+    "    limits:\n"
+    "      max_conn: 5\n"
+    "server2:\n"
+    "  limits:\n"
+    "    max_conn: 6\n"
+    "client:\n"
+    "\n"
+    "  limits:\n"
+    "     max_conn: 7\n"
+    "server:\n"
+    "  limits:\n"
+    "    max_conn: 200";
+
+// Scalar oracle: a statement matches when the keys of its ancestor chain,
+// itself included, match the path's components one to one
+std::vector<yaal::PathMatch> path_query_scalar(const std::vector<std::string>& paths, const std::string& input) {
+    std::vector<std::vector<std::string>> queries;
+    for (const auto& path : paths) {
+        std::vector<std::string> components;
+        size_t start = 0;
+        while (start <= path.size()) {
+            size_t slash = std::min(path.find('/', start), path.size());
+            if (slash > start) components.push_back(path.substr(start, slash - start));
+            start = slash + 1;
+        }
+        if (components.empty()) components.push_back("*");
+        queries.push_back(components);
+    }
+
+    std::vector<yaal::PathMatch> matches;
+    std::vector<std::pair<size_t, std::string>> chain;  // (indent, key) of open ancestors
+    for (size_t line = 0; line < input.size();) {
+        size_t end = std::min(input.find('\n', line), input.size());
+        size_t bos = input.find_first_not_of(' ', line);
+        if (bos < end) {
+            const size_t indent = bos - line;
+            while (!chain.empty() && chain.back().first >= indent) chain.pop_back();
+            size_t key_end = std::min(input.find_first_of(" :\n", bos), input.size());
+            chain.emplace_back(indent, input.substr(bos, key_end - bos));
+            for (size_t q = 0; q < queries.size(); q++) {
+                bool match = queries[q].size() == chain.size();
+                for (size_t i = 0; match && i < chain.size(); i++) {
+                    match = queries[q][i] == "*" || queries[q][i] == chain[i].second;
+                }
+                if (match) matches.push_back(yaal::PathMatch{q, bos, end});
+            }
+        }
+        line = end + 1;
+    }
+    return matches;
+}
+
+suite path_query_tests = [] {
+    "path_exact_match"_test = [] {
+        auto values = run_query({"server/limits/max_conn"}, path_query_doc);
+        expect(eq(values.size(), size_t{2}));
+        expect(values == std::vector<std::string>{"max_conn: 100", "max_conn: 200"});
+    };
+
+    "path_wildcard_only_matches_direct_children"_test = [] {
+        auto values = run_query({"*/limits/max_conn"}, path_query_doc);
+        expect(values == std::vector<std::string>{"max_conn: 100", "max_conn: 6", "max_conn: 7", "max_conn: 200"});
+    };
+
+    "path_prefix_reports_subtree_root"_test = [] {
+        auto values = run_query({"server/limits"}, path_query_doc);
+        expect(values == std::vector<std::string>{"limits:", "limits:"});
+    };
+
+    "path_multiple_queries_one_pass"_test = [] {
+        std::vector<size_t> queries;
+        auto values = run_query({"client/limits/max_conn", "server/name", "nothing/here"}, path_query_doc, &queries);
+        expect(values == std::vector<std::string>{"name: a", "max_conn: 7"});
+        expect(queries == std::vector<size_t>{1, 0});
+    };
+
+    "path_skips_large_non_matching_subtree"_test = [] {
+        // The skipped subtree spans several 192-byte blocks
+        std::string input = "noise\n";
+        for (int i = 0; i < 100; i++) input += "  target: deep\n";
+        input += "target: top\n";
+        auto values = run_query({"target"}, input);
+        expect(values == std::vector<std::string>{"target: top"});
+
+        auto deep = run_query({"noise/target"}, input);
+        expect(eq(deep.size(), size_t{100}));
+    };
+
+    "path_matches_scalar_on_random_documents"_test = [] {
+        // Deep, long-lined subtrees under non-matching keys make the mask
+        // filter skip across blocks, with every indentation up to past 64
+        const char* keys[] = {"a", "b", "c", "ab"};
+        const std::vector<std::string> paths = {"a/b", "*/c", "a/*/b", "c", "b/a/a/a"};
+        auto build = [&keys](Lcg& next) {
+            std::string input;
+            const size_t lines = next() % 120;
+            const size_t step = 1 + next() % 40;
+            size_t indent = 0;
+            for (size_t l = 0; l < lines; l++) {
+                const uint64_t r = next() % 8;
+                if (r < 3) indent += step;
+                else if (r < 6 && indent > 0) indent = next() % (indent + 1);
+                input += std::string(indent, ' ');
+                if (next() % 10 == 0) {
+                    input += "\n";
+                    continue;
+                }
+                input += keys[next() % 4];
+                if (next() % 2) input += ": " + std::string(next() % 90, 'v');
+                if (l + 1 < lines || next() % 2) input += '\n';
+            }
+            return input;
+        };
+        auto check = [&paths](const std::string& input) {
+            yaal::PathQuery query(paths);
+            query.parse(yaal::Buffer(input.data(), input.size()));
+            const auto expected = path_query_scalar(paths, input);
+            bool same = query.matches().size() == expected.size();
+            for (size_t i = 0; same && i < expected.size(); i++) {
+                same = query.matches()[i].query == expected[i].query && query.matches()[i].begin == expected[i].begin &&
+                       query.matches()[i].end == expected[i].end;
+            }
+            return same;
+        };
+        expect(eq(random_document_failures(11, 300, build, check), size_t{0}));
+    };
+
+    "path_query_inside_fanout"_test = [] {
+        // The buffer reaches the query through on_buffer, not its own parse()
+        std::string input = "server:\n  limits:\n    max_conn: 1\n";
+        yaal::Fanout<yaal::CountingParser, yaal::PathQuery> fanout(yaal::CountingParser{},
+                                                                   yaal::PathQuery({"server/limits/max_conn"}));
+        fanout.parse(yaal::Buffer(input.data(), input.size()));
+        expect(eq(fanout.get<1>().matches().size(), size_t{1}));
+        expect(eq(fanout.get<0>().counts().bos, uint64_t{3}));
+
+        const std::vector<std::string> paths = {"*/limits/max_conn", "client/limits"};
+        yaal::Fanout<yaal::PathQuery> wildcard(yaal::PathQuery{paths});
+        wildcard.parse(yaal::Buffer(path_query_doc.data(), path_query_doc.size()));
+        const auto expected = path_query_scalar(paths, path_query_doc);
+        expect(eq(wildcard.get<0>().matches().size(), expected.size()));
+    };
+
+    "path_end_offsets"_test = [] {
+        std::string input = "a\n  b: 1\n  b: 2";
+        yaal::PathQuery query({"a/b"});
+        query.parse(yaal::Buffer(input.data(), input.size()));
+        expect(eq(query.matches().size(), size_t{2}));
+        expect(eq(query.matches()[0].begin, size_t{4}));
+        expect(eq(query.matches()[0].end, size_t{8}));
+        expect(eq(query.matches()[1].end, input.size()));
+    };
+};
+
+// Scalar oracle: statements whose text (from bos on) overlaps an occurrence
+std::vector<yaal::SearchHit> search_scalar(const std::string& input, const std::string& needle) {
+    std::vector<yaal::SearchHit> hits;
+    size_t line_start = 0;
+    uint64_t line = 0;
+    while (line_start <= input.size()) {
+        size_t line_end = input.find('\n', line_start);
+        if (line_end == std::string::npos) line_end = input.size();
+        size_t bos = input.find_first_not_of(' ', line_start);
+        if (bos < line_end) {
+            for (size_t p = input.find(needle, line_start); p != std::string::npos && p + needle.size() <= line_end;
+                 p = input.find(needle, p + 1)) {
+                if (p + needle.size() > bos) {
+                    hits.push_back(yaal::SearchHit{line, bos, line_end});
+                    break;
+                }
+            }
+        }
+        if (line_end == input.size()) break;
+        line_start = line_end + 1;
+        line++;
+    }
+    return hits;
+}
+
+bool same_hits(const std::vector<yaal::SearchHit>& a, const std::vector<yaal::SearchHit>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].line != b[i].line || a[i].begin != b[i].begin || a[i].end != b[i].end) return false;
+    }
+    return true;
+}
+
+suite statement_search_tests = [] {
+    "search_basic_hits"_test = [] {
+        std::string input = "alpha beta\n  gamma\n\n  beta beta\nomega";
+        yaal::StatementSearch search("beta");
+        auto hits = search.search(yaal::Buffer(input.data(), input.size()));
+        expect(eq(hits.size(), size_t{2}));
+        expect(eq(hits[0].line, uint64_t{0}));
+        expect(eq(hits[0].begin, size_t{0}));
+        expect(eq(hits[0].end, size_t{10}));
+        expect(eq(hits[1].line, uint64_t{3}));
+        expect(eq(hits[1].begin, size_t{22}));
+        expect(eq(hits[1].end, size_t{31}));
+    };
+
+    "search_matches_scalar_oracle"_test = [] {
+        std::string input = make_document(300);
+        input += "    trailing line9 without newline";
+        for (const char* needle : {"e", "line1", "value", "9 ", "  value", "line29value", "line", "nope",
+                                   " ", "ne2", "ue\nline"}) {
+            yaal::StatementSearch search(needle);
+            auto hits = search.search(yaal::Buffer(input.data(), input.size()));
+            auto expected = std::string(needle).find('\n') == std::string::npos
+                ? search_scalar(input, needle) : std::vector<yaal::SearchHit>{};
+            expect(same_hits(hits, expected)) << "mismatch for needle '" << needle << "'";
+        }
+    };
+
+    "search_needle_across_block_boundaries"_test = [] {
+        for (size_t offset = 50; offset < 140; offset++) {
+            std::string input(200, 'x');
+            input[10] = '\n';
+            input[12] = '\n';
+            input.replace(offset, 5, "NEEDL");
+            yaal::StatementSearch search("NEEDL");
+            auto hits = search.search(yaal::Buffer(input.data(), input.size()));
+            expect(same_hits(hits, search_scalar(input, "NEEDL"))) << "offset " << offset;
+        }
+    };
+
+    "search_long_needle"_test = [] {
+        std::string needle;
+        for (int i = 0; i < 100; i++) needle += static_cast<char>('a' + i % 26);
+        std::string input = "short\n  " + needle + " tail\n" + needle.substr(0, 99) + "\n";
+        yaal::StatementSearch search(needle);
+        auto hits = search.search(yaal::Buffer(input.data(), input.size()));
+        expect(same_hits(hits, search_scalar(input, needle)));
+        expect(eq(hits.size(), size_t{1}));
+    };
+
+    "search_random_long_lines"_test = [] {
+        // Indentation and lines up to several blocks long, so hits land
+        // blocks after their statement's bos or inside long indentation
+        auto build = [](Lcg& next) {
+            std::string input;
+            const size_t lines = next() % 12;
+            for (size_t l = 0; l < lines; l++) {
+                input += std::string(next() % 150, ' ');
+                const size_t words = next() % 6;
+                for (size_t w = 0; w < words; w++) {
+                    input += std::string(next() % 70, next() % 4 ? 'x' : ' ');
+                    if (next() % 3 == 0) input += "ab";
+                }
+                if (l + 1 < lines || next() % 2) input += '\n';
+            }
+            return input;
+        };
+        auto check = [](const std::string& input) {
+            yaal::StatementSearch search("ab");
+            return same_hits(search.search(yaal::Buffer(input.data(), input.size())), search_scalar(input, "ab"));
+        };
+        expect(eq(random_document_failures(5, 500, build, check), size_t{0}));
+    };
+
+    "search_empty_inputs"_test = [] {
+        yaal::StatementSearch empty_needle("");
+        expect(empty_needle.search(yaal::Buffer("abc", 3)).empty());
+        yaal::StatementSearch search("abc");
+        expect(search.search(yaal::Buffer("", 0)).empty());
+        expect(eq(search.search(yaal::Buffer("abc", 3)).size(), size_t{1}));
+    };
+};
+
+// Statement texts (indentation + trimmed value) in document order
+std::vector<std::string> statement_texts(const std::string& input) {
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (start < input.size()) {
+        size_t end = input.find('\n', start);
+        if (end == std::string::npos) end = input.size();
+        std::string line = input.substr(start, end - start);
+        size_t last = line.find_last_not_of(' ');
+        if (last != std::string::npos) out.push_back(line.substr(0, last + 1));
+        start = end + 1;
+    }
+    return out;
+}
+
+// Bos offsets of a document's statements, in order
+std::vector<size_t> statement_begins(const std::string& doc) {
+    std::vector<size_t> begins;
+    yaal::StatementHasher hasher;
+    hasher.parse(yaal::Buffer(doc.data(), doc.size()));
+    for (const auto& s : hasher.statements()) begins.push_back(s.begin);
+    return begins;
+}
+
+// Checks the diff is a valid edit script and returns how many statements it keeps
+size_t check_diff(const std::string& a, const std::string& b, const std::vector<yaal::DiffEntry>& entries) {
+    auto ta = statement_texts(a);
+    auto tb = statement_texts(b);
+    auto ba = statement_begins(a);
+    auto bb = statement_begins(b);
+
+    std::vector<bool> keep_a(ta.size(), true), keep_b(tb.size(), true);
+    for (const auto& e : entries) {
+        if (e.a_begin != yaal::DiffEntry::npos) {
+            keep_a[std::lower_bound(ba.begin(), ba.end(), e.a_begin) - ba.begin()] = false;
+        }
+        if (e.b_begin != yaal::DiffEntry::npos) {
+            keep_b[std::lower_bound(bb.begin(), bb.end(), e.b_begin) - bb.begin()] = false;
+        }
+    }
+
+    std::vector<std::string> kept_a, kept_b;
+    for (size_t i = 0; i < ta.size(); i++) if (keep_a[i]) kept_a.push_back(ta[i]);
+    for (size_t i = 0; i < tb.size(); i++) if (keep_b[i]) kept_b.push_back(tb[i]);
+    expect(kept_a == kept_b) << "kept statements differ";
+    return kept_a.size();
+}
+
+// Applies the edit script to a's statements, taking new statements from
+// their spans in b and unlisted ones from a
+std::vector<std::string> apply_diff(const std::string& a, const std::string& b,
+                                    const std::vector<yaal::DiffEntry>& entries) {
+    auto ta = statement_texts(a);
+    auto ba = statement_begins(a);
+    auto bb = statement_begins(b);
+    std::vector<std::string> out;
+    size_t next_a = 0;
+    for (const auto& e : entries) {
+        if (e.a_begin != yaal::DiffEntry::npos) {
+            const size_t index = std::lower_bound(ba.begin(), ba.end(), e.a_begin) - ba.begin();
+            while (next_a < index) out.push_back(ta[next_a++]);
+            next_a = index + 1;
+        }
+        if (e.b_begin != yaal::DiffEntry::npos) {
+            const size_t index = std::lower_bound(bb.begin(), bb.end(), e.b_begin) - bb.begin();
+            while (out.size() < index && next_a < ta.size()) out.push_back(ta[next_a++]);
+            const size_t line_start = e.b_begin == 0 ? 0 : b.rfind('\n', e.b_begin - 1) + 1;
+            out.push_back(b.substr(line_start, e.b_end - line_start));
+        }
+    }
+    while (next_a < ta.size()) out.push_back(ta[next_a++]);
+    return out;
+}
+
+// Deterministic edits: change, drop and insert lines of a document
+std::string mutate_document(const std::string& doc, uint64_t seed, int every) {
+    std::string out;
+    size_t start = 0;
+    Lcg next{seed};
+    while (start < doc.size()) {
+        size_t end = doc.find('\n', start);
+        if (end == std::string::npos) end = doc.size();
+        std::string line = doc.substr(start, end - start);
+        const uint64_t r = next();
+        switch (r % every) {
+            case 0: out += line + "x\n"; break;
+            case 1: break;
+            case 2: out += line + "\n  inserted" + std::to_string(r % 100) + "\n"; break;
+            case 3: out += "  " + line + "\n"; break;
+            default: out += line + "\n"; break;
+        }
+        start = end + 1;
+    }
+    return out;
+}
+
+suite diff_tests = [] {
+    "diff_identical_documents"_test = [] {
+        std::string a = make_document(100);
+        expect(yaal::diff(yaal::Buffer(a.data(), a.size()), yaal::Buffer(a.data(), a.size())).empty());
+    };
+
+    "diff_ignores_trailing_spaces_and_blank_lines"_test = [] {
+        std::string a = "a\n  b\n";
+        std::string b = "a   \n\n  b  \n   \n";
+        expect(yaal::diff(yaal::Buffer(a.data(), a.size()), yaal::Buffer(b.data(), b.size())).empty());
+    };
+
+    "diff_reports_kinds_and_offsets"_test = [] {
+        std::string a = "root\n  keep\n  old value\n  gone\nend\n";
+        std::string b = "root\n  keep\n  new value\nend\n    added\n";
+        auto entries = yaal::diff(yaal::Buffer(a.data(), a.size()), yaal::Buffer(b.data(), b.size()));
+        expect(eq(entries.size(), size_t{3}));
+        expect(entries[0].kind == yaal::DiffKind::changed);
+        expect(a.substr(entries[0].a_begin, entries[0].a_end - entries[0].a_begin) == "old value");
+        expect(b.substr(entries[0].b_begin, entries[0].b_end - entries[0].b_begin) == "new value");
+        expect(entries[1].kind == yaal::DiffKind::removed);
+        expect(a.substr(entries[1].a_begin, entries[1].a_end - entries[1].a_begin) == "gone");
+        expect(eq(entries[1].b_begin, yaal::DiffEntry::npos));
+        expect(entries[2].kind == yaal::DiffKind::added);
+        expect(b.substr(entries[2].b_begin, entries[2].b_end - entries[2].b_begin) == "added");
+    };
+
+    "diff_indentation_change_is_a_change"_test = [] {
+        std::string a = "a\n  b\n";
+        std::string b = "a\n    b\n";
+        auto entries = yaal::diff(yaal::Buffer(a.data(), a.size()), yaal::Buffer(b.data(), b.size()));
+        expect(eq(entries.size(), size_t{2}));
+    };
+
+    "diff_reconstructs_b_on_random_edits"_test = [] {
+        std::string a = make_document(150);
+        for (uint64_t seed = 1; seed <= 20; seed++) {
+            std::string b = mutate_document(a, seed, 6 + static_cast<int>(seed % 5));
+            auto entries = yaal::diff(yaal::Buffer(a.data(), a.size()), yaal::Buffer(b.data(), b.size()));
+            check_diff(a, b, entries);
+            expect(apply_diff(a, b, entries) == statement_texts(b)) << "seed " << seed;
+        }
+    };
+
+    "diff_hash_collision_is_not_a_match"_test = [] {
+        std::string a = "root\n  same\n  old\n";
+        std::string b = "root\n  same\n  new\n";
+        yaal::StatementHasher hash_a;
+        yaal::StatementHasher hash_b;
+        hash_a.parse(yaal::Buffer(a.data(), a.size()));
+        hash_b.parse(yaal::Buffer(b.data(), b.size()));
+        // Force a collision between "old" and "new"
+        hash_b.statements()[2].hash = hash_a.statements()[2].hash;
+        auto entries = yaal::StatementAligner(a.data(), hash_a.statements(), b.data(), hash_b.statements(), {}).run();
+        expect(eq(entries.size(), size_t{1}));
+        expect(entries[0].kind == yaal::DiffKind::changed);
+        expect(apply_diff(a, b, entries) == statement_texts(b));
+    };
+
+    "diff_anchor_fallback_stays_valid"_test = [] {
+        std::string a = make_document(300);
+        yaal::DiffOptions options;
+        options.max_edit_cost = 2;
+        for (uint64_t seed = 1; seed <= 10; seed++) {
+            std::string b = mutate_document(a, seed, 4);
+            auto entries = yaal::diff(yaal::Buffer(a.data(), a.size()), yaal::Buffer(b.data(), b.size()), options);
+            check_diff(a, b, entries);
+            expect(apply_diff(a, b, entries) == statement_texts(b)) << "seed " << seed;
+        }
+        std::string empty;
+        auto all_removed = yaal::diff(yaal::Buffer(a.data(), a.size()), yaal::Buffer(empty.data(), 0), options);
+        expect(eq(all_removed.size(), statement_texts(a).size()));
+    };
+};
+
+// Byte-at-a-time state machine from spec.md
+ParseResult parse_with_scalar(const std::string& input) {
+    ParseResult result{0, 0};
+    bool need_bos = true;
+    for (char c : input) {
+        if (c == '\n') {
+            result.eol++;
+            need_bos = true;
+        } else if (c != ' ' && need_bos) {
+            result.bos++;
+            need_bos = false;
+        }
+    }
+    return result;
+}
+
+ParseResult parse_with_speculative(const std::string& input) {
+    yaal::SpeculativeCountingParser parser;
+    yaal::Buffer buf(input.data(), input.size());
+    parser.parse(buf);
+    return {parser.counts().bos, parser.counts().eol};
+}
+
+// Events in emission order on any kernel: 'b' bos, 'e' eol (no batch
+// support, so the per-event path is used)
+template<template<typename> class Base>
+struct OrderedRecorder : Base<OrderedRecorder<Base>> {
+    void on_bod(size_t) {}
+    void on_bos(size_t offset) { events.emplace_back('b', offset); }
+    void on_eol(size_t offset) { events.emplace_back('e', offset); }
+    void on_eod(size_t) {}
+
+    std::vector<std::pair<char, size_t>> events;
+};
+
+// Events of the spec.md state machine, in emission order
+std::vector<std::pair<char, size_t>> ordered_scalar(const std::string& input) {
+    std::vector<std::pair<char, size_t>> events;
+    bool need_bos = true;
+    for (size_t i = 0; i < input.size(); i++) {
+        if (input[i] == '\n') {
+            events.emplace_back('e', i);
+            need_bos = true;
+        } else if (input[i] != ' ' && need_bos) {
+            events.emplace_back('b', i);
+            need_bos = false;
+        }
+    }
+    return events;
+}
+
+suite event_order_tests = [] {
+    "base_per_event_path_is_positional"_test = [] {
+        // Short lines put several eol and bos bits in one 64-bit mask, so
+        // a walk of all eol bits before all bos bits would reorder them;
+        // sizes cover the 192-byte loop, the 64- and 32-byte chunks and
+        // the scalar tail
+        size_t failures = 0;
+        for (size_t size = 0; size <= 600; size++) {
+            std::string input(size, ' ');
+            for (size_t i = 0; i < size; i++) {
+                if (i % 5 == 4) input[i] = '\n';
+                else if (i % 3 == 0) input[i] = 'x';
+            }
+            OrderedRecorder<yaal::ParserBase> base;
+            base.parse(yaal::Buffer(input.data(), input.size()));
+            if (base.events != ordered_scalar(input)) failures++;
+        }
+        expect(eq(failures, size_t{0}));
+
+        OrderedRecorder<yaal::ParserBase> base;
+        std::string input = "a\nb\n  c\n";
+        base.parse(yaal::Buffer(input.data(), input.size()));
+        expect(base.events == std::vector<std::pair<char, size_t>>{{'b', 0}, {'e', 1}, {'b', 2}, {'e', 3}, {'b', 6}, {'e', 7}});
+    };
+};
+
+suite speculative_tests = [] {
+    "speculative_matches_scalar_on_documents"_test = [] {
+        for (size_t lines : {0, 1, 5, 50, 500}) {
+            std::string input = make_document(lines);
+            auto expected = parse_with_scalar(input);
+            auto spec = parse_with_speculative(input);
+            expect(eq(spec.bos, expected.bos)) << "BOS mismatch for " << lines << " lines";
+            expect(eq(spec.eol, expected.eol)) << "EOL mismatch for " << lines << " lines";
+        }
+    };
+
+    "speculative_events_in_positional_order"_test = [] {
+        std::string input = make_document(300);
+        yaal::Buffer buf(input.data(), input.size());
+        OrderedRecorder<yaal::SpeculativeParserBase> spec;
+        spec.parse(buf);
+        OrderedRecorder<yaal::ParserBase> base;
+        base.parse(buf);
+        expect(spec.events == base.events) << "event streams differ";
+    };
+
+    "exhaustive_chunk_boundaries_all_kernels"_test = [] {
+        // Every 4-byte pattern of {space, newline, 'a'} straddling each
+        // 64-byte boundary, over backgrounds that break or carry need_bos
+        // across blocks, long enough for two 512-byte iterations plus tails.
+        // Counts cover the batch paths, ordered recorders the per-event ones.
+        const char alphabet[] = {' ', '\n', 'a'};
+        const size_t size = 1100;
+        size_t failures = 0;
+        for (char background : {'a', ' '}) {
+            for (size_t boundary = 64; boundary < size; boundary += 64) {
+                for (int pattern = 0; pattern < 81; pattern++) {
+                    std::string input(size, background);
+                    input[0] = '\n';
+                    int p = pattern;
+                    for (size_t i = 0; i < 4; i++, p /= 3) input[boundary - 2 + i] = alphabet[p % 3];
+
+                    auto expected = parse_with_scalar(input);
+                    auto spec = parse_with_speculative(input);
+                    auto counting = parse_with_counting(input);
+                    auto ref = parse_with_reference(input);
+                    if (spec.bos != expected.bos || spec.eol != expected.eol ||
+                        counting.bos != expected.bos || counting.eol != expected.eol ||
+                        ref.bos != expected.bos || ref.eol != expected.eol) {
+                        failures++;
+                    }
+
+                    const yaal::Buffer buf(input.data(), input.size());
+                    const auto ordered = ordered_scalar(input);
+                    OrderedRecorder<yaal::ParserBase> base_events;
+                    base_events.parse(buf);
+                    OrderedRecorder<yaal::SpeculativeParserBase> spec_events;
+                    spec_events.parse(buf);
+                    OrderedRecorder<yaal::QuotedParserBase> quoted_events;
+                    quoted_events.parse(buf);
+                    if (base_events.events != ordered || spec_events.events != ordered ||
+                        quoted_events.events != ordered) {
+                        failures++;
+                    }
+                }
+            }
+        }
+        expect(eq(failures, size_t{0}));
+    };
+
+    "speculative_every_size_to_1100"_test = [] {
+        for (size_t size = 0; size <= 1100; size++) {
+            std::string input(size, ' ');
+            for (size_t i = 0; i < size; i++) {
+                if (i % 97 == 13) input[i] = '\n';
+                else if (i % 7 == 3) input[i] = 'x';
+            }
+            auto expected = parse_with_scalar(input);
+            auto spec = parse_with_speculative(input);
+            expect(eq(spec.bos, expected.bos)) << "BOS mismatch at size " << size;
+            expect(eq(spec.eol, expected.eol)) << "EOL mismatch at size " << size;
+        }
+    };
+};
+
+// Block scalar events in emission order: 'b' bos, 'e' eol, 's' span
+struct BlockEvent {
+    char kind;
+    size_t begin;
+    size_t end;
+    bool operator==(const BlockEvent& o) const {
+        return kind == o.kind && begin == o.begin && end == o.end;
+    }
+};
+
+class BlockScalarRecorder : public yaal::BlockScalarParserBase<BlockScalarRecorder> {
+public:
+    void on_bod(size_t) {}
+    void on_bos(size_t offset) { events.push_back({'b', offset, offset}); }
+    void on_eol(size_t offset) { events.push_back({'e', offset, offset}); }
+    void on_eod(size_t) {}
+    void on_block_scalar(size_t begin, size_t end) { events.push_back({'s', begin, end}); }
+
+    std::vector<BlockEvent> events;
+};
+
+class BlockScalarCounter : public yaal::BlockScalarParserBase<BlockScalarCounter> {
+public:
+    void on_bod(size_t) {}
+    void on_bos(size_t) { bos++; }
+    void on_eol(size_t) { eol++; }
+    void on_eod(size_t) {}
+    void on_block_scalar(size_t, size_t) { spans++; }
+
+    static constexpr bool supports_batch = true;
+    void on_eol_batch(uint64_t count) { eol += count; }
+    void on_bos_batch(uint64_t count) { bos += count; }
+
+    uint64_t bos = 0;
+    uint64_t eol = 0;
+    uint64_t spans = 0;
+};
+
+// Line-by-line reference for block scalar semantics
+std::vector<BlockEvent> block_scalar_scalar(const std::string& input) {
+    std::vector<BlockEvent> events;
+    bool in_block = false;
+    size_t owner = 0, begin = 0, content_end = 0;
+    bool has_content = false;
+
+    size_t ls = 0;
+    while (ls < input.size()) {
+        size_t le = input.find('\n', ls);
+        if (le == std::string::npos) le = input.size();
+        size_t first = input.find_first_not_of(' ', ls);
+        if (first < le) {
+            size_t indent = first - ls;
+            if (in_block && indent > owner) {
+                has_content = true;
+                content_end = le;
+            } else {
+                if (in_block) {
+                    events.push_back({'s', begin, has_content ? content_end : begin});
+                    in_block = false;
+                }
+                events.push_back({'b', first, first});
+                size_t last = input.find_last_not_of(' ', le - 1);
+                if (le < input.size() && (input[last] == '|' || input[last] == '>')) {
+                    in_block = true;
+                    owner = indent;
+                    begin = le + 1;
+                    has_content = false;
+                }
+            }
+        }
+        if (le < input.size()) events.push_back({'e', le, le});
+        ls = le + 1;
+    }
+    if (in_block) events.push_back({'s', begin, has_content ? content_end : begin});
+    return events;
+}
+
+std::vector<BlockEvent> parse_block_scalars(const std::string& input) {
+    yaal::Buffer buf(input.data(), input.size());
+    BlockScalarRecorder recorder;
+    recorder.parse(buf);
+    return recorder.events;
+}
+
+// Random lines mixing indentation, blank lines, markers and trailing spaces
+std::string block_scalar_document(Lcg& next, size_t lines) {
+    std::string doc;
+    for (size_t i = 0; i < lines; i++) {
+        doc += std::string(next() % 9, ' ');
+        if (next() % 6 != 0) {
+            size_t words = next() % 4 + 1;
+            for (size_t w = 0; w < words; w++) {
+                doc += std::string(next() % 30 + 1, static_cast<char>('a' + next() % 3));
+                if (w + 1 < words) doc += ' ';
+            }
+            switch (next() % 5) {
+                case 0: doc += " |"; break;
+                case 1: doc += ">"; break;
+                case 2: doc += " | x"; break;
+                default: break;
+            }
+            doc += std::string(next() % 3, ' ');
+        }
+        doc += '\n';
+    }
+    return doc;
+}
+
+suite block_scalar_tests = [] {
+    "block_scalar_suppresses_deeper_lines"_test = [] {
+        std::string input = "a: |\n  one\n    two\n\n  three\nb: x\n";
+        auto events = parse_block_scalars(input);
+        std::vector<BlockEvent> expected = {
+            {'b', 0, 0}, {'e', 4, 4}, {'e', 10, 10}, {'e', 18, 18}, {'e', 19, 19},
+            {'e', 27, 27}, {'s', 5, 27}, {'b', 28, 28}, {'e', 32, 32},
+        };
+        expect(events == expected);
+        expect(events == block_scalar_scalar(input));
+    };
+
+    "block_scalar_folded_and_nested_owner"_test = [] {
+        std::string input = "root\n  text: >  \n    folded\n  next\n";
+        auto events = parse_block_scalars(input);
+        expect(events == block_scalar_scalar(input));
+        size_t spans = std::count_if(events.begin(), events.end(),
+                                     [](const BlockEvent& e) { return e.kind == 's'; });
+        expect(eq(spans, size_t{1}));
+        expect(events[5] == BlockEvent{'s', 17, 27}) << "span covers the folded line";
+    };
+
+    "block_scalar_empty_and_at_eod"_test = [] {
+        expect(parse_block_scalars("a: |\nb\n") == block_scalar_scalar("a: |\nb\n"));
+        expect(parse_block_scalars("a: |\n  x") == block_scalar_scalar("a: |\n  x"));
+        expect(parse_block_scalars("a: |\n\n  ") == block_scalar_scalar("a: |\n\n  "));
+        expect(parse_block_scalars("a: |") == block_scalar_scalar("a: |"));
+        expect(parse_block_scalars("a | b\n  c\n") == block_scalar_scalar("a | b\n  c\n"));
+    };
+
+    "block_scalar_marker_inside_block_is_text"_test = [] {
+        std::string input = "a: |\n  b: |\n    c\n  d\ne\n";
+        auto events = parse_block_scalars(input);
+        expect(events == block_scalar_scalar(input));
+        size_t bos = std::count_if(events.begin(), events.end(),
+                                   [](const BlockEvent& e) { return e.kind == 'b'; });
+        expect(eq(bos, size_t{2}));
+    };
+
+    "block_scalar_long_block_across_chunks"_test = [] {
+        std::string input = "cert: |\n";
+        for (int i = 0; i < 200; i++) input += "  " + std::string(70, 'A' + i % 26) + "\n";
+        input += "next: 1\n";
+        auto events = parse_block_scalars(input);
+        expect(events == block_scalar_scalar(input));
+        expect(events[events.size() - 3] == BlockEvent{'s', 8, input.size() - 9});
+    };
+
+    "block_scalar_random_documents"_test = [] {
+        auto build = [](Lcg& next) {
+            std::string input = block_scalar_document(next, next() % 60 + 1);
+            if (next() % 3 == 0) input.pop_back();  // no trailing newline
+            return input;
+        };
+        auto check = [](const std::string& input) {
+            auto expected = block_scalar_scalar(input);
+            if (parse_block_scalars(input) != expected) return false;
+
+            BlockScalarCounter counter;
+            yaal::Buffer buf(input.data(), input.size());
+            counter.parse(buf);
+            auto count = [&](char kind) {
+                return static_cast<uint64_t>(std::count_if(
+                    expected.begin(), expected.end(), [kind](const BlockEvent& e) { return e.kind == kind; }));
+            };
+            return counter.bos == count('b') && counter.eol == count('e') && counter.spans == count('s');
+        };
+        expect(eq(random_document_failures(1, 300, build, check), size_t{0}));
+    };
+
+    "block_scalar_body_indentation_random"_test = [] {
+        // Rare markers, so whole chunks are body text: short and blank body
+        // lines, indentation running over chunk boundaries, owners up to 70
+        auto build = [](Lcg& next) {
+            std::string input;
+            for (int block = 0; block < 4; block++) {
+                const size_t owner = next() % 72;
+                input += std::string(owner, ' ') + "key: " + (next() % 2 ? "|" : ">") + "\n";
+                const size_t lines = next() % 30;
+                for (size_t l = 0; l < lines; l++) {
+                    const size_t shape = next() % 8;
+                    size_t indent = owner + 1 + next() % 40;
+                    if (shape == 0) indent = next() % (owner + 1);  // closes the block
+                    if (shape == 1) indent = owner + 1 + next() % 100;
+                    input += std::string(indent, ' ');
+                    if (shape != 2) input += std::string(next() % (shape == 3 ? 2 : 50) + 1, 'x');
+                    input += '\n';
+                }
+            }
+            return input;
+        };
+        auto check = [](const std::string& input) { return parse_block_scalars(input) == block_scalar_scalar(input); };
+        expect(eq(random_document_failures(7, 400, build, check), size_t{0}));
+    };
+
+    "block_scalar_marker_at_chunk_boundaries"_test = [] {
+        // Marker, trailing spaces and newline shifted over the 64-byte boundary
+        size_t failures = 0;
+        for (size_t prefix = 40; prefix < 140; prefix++) {
+            for (size_t trailing = 0; trailing < 4; trailing++) {
+                std::string input(prefix, 'k');
+                input += " |" + std::string(trailing, ' ') + "\n";
+                input += std::string(prefix % 5 + 1, ' ') + std::string(prefix, 'v') + "\n";
+                input += "end\n";
+                if (parse_block_scalars(input) != block_scalar_scalar(input)) failures++;
+            }
+        }
+        expect(eq(failures, size_t{0}));
+    };
+};
+
+// Byte-by-byte reference: a backslash escapes the next byte, an unescaped
+// quote toggles the string, and quoted bytes (opening quote included) are text
+std::vector<std::pair<char, size_t>> quoted_scalar(const std::string& input) {
+    std::vector<std::pair<char, size_t>> events;
+    bool need_bos = true, in_string = false, escaped = false;
+    for (size_t i = 0; i < input.size(); i++) {
+        const char c = input[i];
+        const bool was_escaped = escaped;
+        escaped = c == '\\' && !was_escaped;
+        if (c == '"' && !was_escaped) in_string = !in_string;
+        if (in_string || (c != '\n' && c != ' ')) {
+            if (need_bos) events.emplace_back('b', i);
+            need_bos = false;
+        } else if (c == '\n') {
+            events.emplace_back('e', i);
+            need_bos = true;
+        }
+    }
+    return events;
+}
+
+std::vector<std::pair<char, size_t>> parse_quoted(const std::string& input) {
+    yaal::Buffer buf(input.data(), input.size());
+    OrderedRecorder<yaal::QuotedParserBase> recorder;
+    recorder.parse(buf);
+    return recorder.events;
+}
+
+ParseResult parse_with_quoted(const std::string& input) {
+    yaal::QuotedCountingParser parser;
+    yaal::Buffer buf(input.data(), input.size());
+    parser.parse(buf);
+    return {parser.counts().bos, parser.counts().eol};
+}
+
+suite quoted_tests = [] {
+    "quoted_newlines_are_not_line_ends"_test = [] {
+        std::string input = "a: \"one\n  two\"\nb: x\n";
+        auto events = parse_quoted(input);
+        std::vector<std::pair<char, size_t>> expected = {{'b', 0}, {'e', 14}, {'b', 15}, {'e', 19}};
+        expect(events == expected);
+        expect(events == quoted_scalar(input));
+    };
+
+    "quoted_escapes"_test = [] {
+        for (std::string input : {"a \"x\\\"\ny\"\nb\n", "a \"x\\\\\"\ny\"\nb\n", "a \\\"\nb\n",
+                                  "\"\\\\\\\"\n\"\n", "\"open\n  to the end", "\"\"\n\"\"\n"}) {
+            expect(parse_quoted(input) == quoted_scalar(input)) << input;
+        }
+    };
+
+    "quoted_unquoted_documents_match_parser_base"_test = [] {
+        for (size_t lines : {0, 1, 5, 50, 500}) {
+            std::string input = make_document(lines);
+            auto expected = parse_with_scalar(input);
+            auto quoted = parse_with_quoted(input);
+            expect(eq(quoted.bos, expected.bos)) << "BOS mismatch for " << lines << " lines";
+            expect(eq(quoted.eol, expected.eol)) << "EOL mismatch for " << lines << " lines";
+        }
+    };
+
+    "quoted_backslash_runs_across_chunk_boundaries"_test = [] {
+        // Backslash runs of every length ending at each offset around the
+        // 64-byte and 192-byte boundaries, inside and outside a string,
+        // followed by a quote and a newline
+        size_t failures = 0;
+        for (std::string open : {"k: \"", "k: "}) {
+            for (size_t end = 50; end < 400; end++) {
+                for (size_t run = 0; run < 6; run++) {
+                    std::string input = open + std::string(end - open.size() - run, 'x') + std::string(run, '\\') +
+                                        "\"\n z\n\"\n";
+                    if (parse_quoted(input) != quoted_scalar(input)) failures++;
+                }
+            }
+        }
+        expect(eq(failures, size_t{0}));
+    };
+
+    "quoted_random_documents"_test = [] {
+        // Small alphabet so quotes, escapes and newlines land everywhere,
+        // including long strings spanning several 192-byte groups
+        const char alphabet[] = {' ', ' ', '\n', 'a', 'b', '"', '\\'};
+        auto build = [&alphabet](Lcg& next) {
+            std::string input;
+            const size_t size = next() % 1500;
+            const size_t rare = next() % 4;
+            for (size_t i = 0; i < size; i++) {
+                size_t pick = next() % 7;
+                if (pick >= 5 && next() % (1 + rare * 40) != 0) pick = 3;
+                input += alphabet[pick];
+            }
+            return input;
+        };
+        auto check = [](const std::string& input) {
+            const auto expected = quoted_scalar(input);
+            if (parse_quoted(input) != expected) return false;
+
+            size_t bos = 0, eol = 0;
+            for (const auto& e : expected) (e.first == 'b' ? bos : eol)++;
+            auto counted = parse_with_quoted(input);
+            return counted.bos == bos && counted.eol == eol;
+        };
+        expect(eq(random_document_failures(11, 500, build, check), size_t{0}));
+    };
+};
+
+class StringSink : public yaal::OutputSink {
+public:
+    void write(const char* data, size_t len) override {
+        out.append(data, len);
+        writes++;
+    }
+
+    std::string out;
+    size_t writes = 0;
+};
+
+// Line-by-line reference for Writer normalization
+std::string normalize_scalar(const std::string& input, size_t width) {
+    std::string out;
+    std::vector<size_t> indents;
+    size_t ls = 0;
+    while (ls < input.size()) {
+        size_t le = input.find('\n', ls);
+        if (le == std::string::npos) le = input.size();
+        size_t first = input.find_first_not_of(' ', ls);
+        if (first < le) {
+            const size_t indent = first - ls;
+            while (!indents.empty() && indents.back() >= indent) indents.pop_back();
+            out += std::string(indents.size() * width, ' ');
+            indents.push_back(indent);
+            size_t last = input.find_last_not_of(' ', le - 1);
+            out.append(input, first, last + 1 - first);
+            out += '\n';
+        }
+        ls = le + 1;
+    }
+    return out;
+}
+
+std::string normalize(const std::string& input, size_t width, size_t buffer_size = yaal::Writer::default_buffer_size) {
+    StringSink sink;
+    yaal::Writer writer(sink, width, buffer_size);
+    yaal::Buffer buf(input.data(), input.size());
+    writer.parse(buf);
+    return sink.out;
+}
+
+// Hands recorded event batches straight back to a Writer
+class ReplaySink : public yaal::EventSink {
+public:
+    ReplaySink(yaal::Writer& writer, const yaal::Buffer& buf) : writer_(writer), buf_(buf) {}
+
+    void on_events(const yaal::Event* events, size_t count) override { writer_.write(buf_, events, count); }
+
+private:
+    yaal::Writer& writer_;
+    yaal::Buffer buf_;
+};
+
+suite writer_tests = [] {
+    "writer_normalizes_indentation_and_whitespace"_test = [] {
+        std::string input = "a\n    b  \n\n   \n        c\n  d\ne";
+        expect(eq(normalize(input, 2), std::string("a\n  b\n    c\n  d\ne\n")));
+        expect(eq(normalize(input, 2), normalize_scalar(input, 2)));
+        expect(eq(normalize("", 2), std::string()));
+        expect(eq(normalize("  \n\n ", 4), std::string()));
+    };
+
+    "writer_matches_scalar_on_random_documents"_test = [] {
+        // Small buffers force flushes and direct writes of long runs
+        auto build = [](Lcg& next) {
+            std::string input = block_scalar_document(next, next() % 80 + 1);
+            if (next() % 4 == 0) input.pop_back();
+            return input;
+        };
+        auto check = [](const std::string& input) {
+            for (size_t width : {0, 2, 4}) {
+                for (size_t buffer_size : {64, 200, 1 << 20}) {
+                    if (normalize(input, width, buffer_size) != normalize_scalar(input, width)) return false;
+                }
+            }
+            return true;
+        };
+        expect(eq(random_document_failures(1, 200, build, check), size_t{0}));
+    };
+
+    "writer_passes_normalized_input_through_in_one_write"_test = [] {
+        std::string input = normalize_scalar(make_document(2000), 2);
+        StringSink sink;
+        yaal::Writer writer(sink, 2, 4096);
+        yaal::Buffer buf(input.data(), input.size());
+        writer.parse(buf);
+        expect(sink.out == input);
+        expect(eq(sink.writes, size_t{1}));
+        expect(eq(writer.bytes_written(), uint64_t(input.size())));
+    };
+
+    "writer_replays_recorded_events"_test = [] {
+        std::string input = make_document(500);
+        yaal::Buffer buf(input.data(), input.size());
+        StringSink sink;
+        yaal::Writer writer(sink, 3, 256);
+        ReplaySink replay(writer, buf);
+        yaal::BufferedSinkParser<16> recorder(replay);
+        recorder.parse(buf);
+        expect(eq(sink.out, normalize_scalar(input, 3)));
+    };
+
+    "file_sink_reports_short_writes"_test = [] {
+        std::string input = make_document(500);
+        yaal::Buffer buf(input.data(), input.size());
+
+        std::FILE* file = std::tmpfile();
+        yaal::FileSink sink(file);
+        yaal::Writer(sink, 2, 256).parse(buf);
+        expect(!sink.failed());
+        std::string written(static_cast<size_t>(std::ftell(file)), '\0');
+        std::rewind(file);
+        expect(eq(std::fread(written.data(), 1, written.size(), file), written.size()));
+        expect(eq(written, normalize_scalar(input, 2)));
+        std::fclose(file);
+
+        // Not open for writing: the first write comes up short and the flag sticks
+        std::FILE* read_only = std::fopen("/dev/null", "r");
+        yaal::FileSink failing(read_only);
+        yaal::Writer(failing, 2, 256).parse(buf);
+        expect(failing.failed());
+        failing.write("x", 1);
+        expect(failing.failed());
+        std::fclose(read_only);
+    };
+};
+
+// DOM-based reference for JsonTranscoder: builds the statement tree, then
+// serializes it
+struct JsonNode {
+    std::string text;
+    std::vector<JsonNode> children;
+};
+
+std::string json_escape_scalar(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    const char hex[] = "0123456789abcdef";
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0xF];
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    return out + "\"";
+}
+
+bool json_is_item(const std::string& t) { return t[0] == '-' && (t.size() == 1 || t[1] == ' '); }
+
+// What the transcoder must report as lost
+struct JsonLosses {
+    uint64_t dropped_values = 0;
+    uint64_t duplicate_keys = 0;
+};
+
+std::string json_container_scalar(const std::vector<JsonNode>& nodes, JsonLosses& losses) {
+    if (nodes.empty()) return "{}";
+    const bool array = json_is_item(nodes[0].text);
+    std::string out = array ? "[" : "{";
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < nodes.size(); i++) {
+        if (i > 0) out += ',';
+        const std::string& t = nodes[i].text;
+        const bool leaf = nodes[i].children.empty();
+        if (array) {
+            if (!json_is_item(t)) {
+                if (!leaf) losses.dropped_values++;
+                out += leaf ? json_escape_scalar(t) : json_container_scalar(nodes[i].children, losses);
+                continue;
+            }
+            size_t skip = t.find_first_not_of(' ', 1);
+            if (!leaf && skip != std::string::npos) losses.dropped_values++;
+            if (!leaf) out += json_container_scalar(nodes[i].children, losses);
+            else if (skip == std::string::npos) out += "null";
+            else out += json_escape_scalar(t.substr(skip));
+            continue;
+        }
+        size_t sep = std::string::npos;
+        for (size_t at = t.find(':'); at != std::string::npos; at = t.find(':', at + 1)) {
+            if (at + 1 == t.size() || t[at + 1] == ' ') {
+                sep = at;
+                break;
+            }
+        }
+        std::string key = t.substr(0, sep);
+        std::string value = sep == std::string::npos ? "" : t.substr(sep + 1);
+        key.erase(key.find_last_not_of(' ') + 1);
+        value.erase(0, value.find_first_not_of(' ') == std::string::npos ? value.size() : value.find_first_not_of(' '));
+        if (std::find(keys.begin(), keys.end(), key) != keys.end()) losses.duplicate_keys++;
+        keys.push_back(key);
+        if (!leaf && !value.empty()) losses.dropped_values++;
+        out += json_escape_scalar(key) + ":";
+        if (!leaf) out += json_container_scalar(nodes[i].children, losses);
+        else out += value.empty() ? "null" : json_escape_scalar(value);
+    }
+    return out + (array ? "]" : "}");
+}
+
+std::string json_scalar(const std::string& input, JsonLosses& losses) {
+    std::vector<JsonNode> roots;
+    std::vector<std::pair<size_t, std::vector<JsonNode>*>> open;  // indentation, children list
+    size_t ls = 0;
+    while (ls < input.size()) {
+        size_t le = input.find('\n', ls);
+        if (le == std::string::npos) le = input.size();
+        size_t first = input.find_first_not_of(' ', ls);
+        if (first < le) {
+            const size_t indent = first - ls;
+            while (!open.empty() && open.back().first >= indent) open.pop_back();
+            std::vector<JsonNode>& siblings = open.empty() ? roots : *open.back().second;
+            size_t last = input.find_last_not_of(' ', le - 1);
+            siblings.push_back(JsonNode{input.substr(first, last + 1 - first), {}});
+            open.emplace_back(indent, &siblings.back().children);
+        }
+        ls = le + 1;
+    }
+    return json_container_scalar(roots, losses);
+}
+
+std::string json_scalar(const std::string& input) {
+    JsonLosses losses;
+    return json_scalar(input, losses);
+}
+
+std::string transcode(const std::string& input) {
+    yaal::JsonTranscoder transcoder;
+    yaal::Buffer buf(input.data(), input.size());
+    transcoder.parse(buf);
+    return std::string(transcoder.output(), transcoder.output_size());
+}
+
+suite json_tests = [] {
+    "json_objects_arrays_and_nulls"_test = [] {
+        std::string input = "name: yaal\nserver:\n  port: 80\n  hosts\n    - a\n    -\n    - b: c\n  tls\nend:\n";
+        expect(eq(transcode(input),
+                  std::string("{\"name\":\"yaal\",\"server\":{\"port\":\"80\",\"hosts\":[\"a\",null,\"b: c\"],"
+                              "\"tls\":null},\"end\":null}")));
+        expect(eq(transcode(input), json_scalar(input)));
+        expect(eq(transcode("- x\n- y\n"), std::string("[\"x\",\"y\"]")));
+        expect(eq(transcode(""), std::string("{}")));
+        expect(eq(transcode(" \n\n"), std::string("{}")));
+        expect(eq(transcode("a: b: c\nurl http://x\nk:v"),
+                  std::string("{\"a\":\"b: c\",\"url http://x\":null,\"k:v\":null}")));
+    };
+
+    "json_escapes_strings"_test = [] {
+        std::string input = "k: say \"hi\" \\ back\tslash\x01\x1f" + std::string(70, 'z') + "\"\n";
+        expect(eq(transcode(input), json_scalar(input)));
+        std::string utf8 = "caf\xC3\xA9: na\xC3\xAFve \xE2\x82\xAC\n";
+        expect(eq(transcode(utf8), std::string("{\"caf\xC3\xA9\":\"na\xC3\xAFve \xE2\x82\xAC\"}")));
+    };
+
+    "json_matches_dom_reference_on_random_documents"_test = [] {
+        // Random indentation, list items, separators and bytes that need
+        // escaping, at every position of the 32-byte string chunks
+        const char* pieces[] = {"- ", "-", "key", ": ", ":", "\"", "\\", "\t", "value", " ", "x", "\x02"};
+        auto build = [&pieces](Lcg& next) {
+            std::string input;
+            const size_t lines = next() % 40;
+            for (size_t l = 0; l < lines; l++) {
+                input += std::string(next() % 4 * 2 + next() % 2, ' ');
+                const size_t parts = next() % 12;
+                for (size_t i = 0; i < parts; i++) input += pieces[next() % 12];
+                if (next() % 5 == 0) input += std::string(next() % 60, 'w');
+                input += std::string(next() % 3, ' ');
+                if (l + 1 < lines || next() % 2) input += '\n';
+            }
+            return input;
+        };
+        auto check = [](const std::string& input) {
+            yaal::JsonOptions options;
+            options.count_duplicate_keys = true;
+            yaal::JsonTranscoder transcoder(options);
+            transcoder.parse(yaal::Buffer(input.data(), input.size()));
+            JsonLosses losses;
+            return std::string(transcoder.output(), transcoder.output_size()) == json_scalar(input, losses) &&
+                   transcoder.dropped_values() == losses.dropped_values &&
+                   transcoder.duplicate_keys() == losses.duplicate_keys;
+        };
+        expect(eq(random_document_failures(3, 400, build, check), size_t{0}));
+    };
+
+    "json_reports_dropped_values_and_duplicate_keys"_test = [] {
+        auto losses = [](const std::string& input, bool count_duplicate_keys = true) {
+            yaal::JsonOptions options;
+            options.count_duplicate_keys = count_duplicate_keys;
+            yaal::JsonTranscoder transcoder(options);
+            transcoder.parse(yaal::Buffer(input.data(), input.size()));
+            return std::make_pair(transcoder.dropped_values(), transcoder.duplicate_keys());
+        };
+        using Counts = std::pair<uint64_t, uint64_t>;
+        expect(losses("a: 1\nb\n  c: 2\nlist\n  - x\n") == Counts{0, 0});
+        // Inline values under children: a key, an item and a non-item in an array
+        expect(losses("a: 1\n  b: 2\n") == Counts{1, 0});
+        expect(losses("- x\n  k: v\n-\n  k: v\ntext\n  k: v\n") == Counts{2, 0});
+        // Duplicates count per object: nested objects and closed siblings don't clash
+        expect(losses("a: 1\nb\n  a: 2\n  a: 3\nc\n  a\na: 4\na\n") == Counts{0, 3});
+        // Duplicates are only counted on request
+        expect(losses("a: 1\n  b: 2\na: 3\n", false) == Counts{1, 0});
+        expect(losses("- x\n  k: 1\n- y\n  k: 2\n") == Counts{2, 0});
+
+        // Many keys in one object and many short-lived objects, across rehashes
+        std::string wide;
+        for (int i = 0; i < 5000; i++) wide += "k" + std::to_string(i % 4000) + ": v\n";
+        for (int i = 0; i < 2000; i++) wide += "o" + std::to_string(i) + "\n  x: 1\n  y: 2\n";
+        expect(losses(wide) == Counts{0, 1000});
+        expect(losses("") == Counts{0, 0});
+    };
+
+    "json_sink_output_matches_growable_buffer"_test = [] {
+        std::string input = make_document(3000);
+        StringSink sink;
+        yaal::JsonTranscoder transcoder(sink, 4096);
+        yaal::Buffer buf(input.data(), input.size());
+        transcoder.parse(buf);
+        expect(eq(sink.out, transcode(input)));
+        expect(sink.writes > size_t{1});
+        expect(eq(transcoder.bytes_written(), uint64_t(sink.out.size())));
+        expect(transcoder.memory_footprint() < size_t(16384));
+    };
+};
+
+// Ground truth recounted byte by byte, with eos and comments as in spec.md;
+// an unterminated last line of spaces is blank, an empty one no line at all
+yaal::CorpusCounts corpus_scalar(const std::vector<char>& doc) {
+    yaal::CorpusCounts counts;
+    counts.bytes = doc.size();
+    bool need_bos = true;
+    for (char c : doc) {
+        if (c == '\n') {
+            if (!need_bos) counts.eos++;
+            else counts.blank++;
+            counts.eol++;
+            need_bos = true;
+        } else if (c != ' ' && need_bos) {
+            counts.bos++;
+            if (c == '#') counts.comments++;
+            need_bos = false;
+        }
+    }
+    if (!need_bos) counts.eos++;
+    else if (!doc.empty() && doc.back() != '\n') counts.blank++;
+    return counts;
+}
+
+// Valid UTF-8 without overlong forms or surrogates
+bool valid_utf8(const std::vector<char>& doc) {
+    for (size_t i = 0; i < doc.size();) {
+        const unsigned char c = doc[i];
+        size_t n = c < 0x80 ? 0 : c >= 0xF0 && c <= 0xF4 ? 3 : c >= 0xE0 ? 2 : c >= 0xC2 && c < 0xE0 ? 1 : 4;
+        if (n == 4 || i + n >= doc.size() + (n ? 0 : 1)) return false;
+        uint32_t cp = n == 0 ? c : c & (0x3F >> n);
+        for (size_t k = 1; k <= n; k++) {
+            if ((static_cast<unsigned char>(doc[i + k]) & 0xC0) != 0x80) return false;
+            cp = (cp << 6) | (doc[i + k] & 0x3F);
+        }
+        if ((n == 2 && (cp < 0x800 || (cp >= 0xD800 && cp < 0xE000))) || (n == 3 && (cp < 0x10000 || cp > 0x10FFFF)))
+            return false;
+        i += n + 1;
+    }
+    return true;
+}
+
+suite corpus_tests = [] {
+    "corpus_counts_match_parsers_for_every_shape"_test = [] {
+        std::vector<yaal::CorpusShape> shapes(4);
+        shapes[1].line_lengths = yaal::LineLengths::exponential;
+        shapes[1].comment_ratio = 0.3;
+        shapes[1].utf8_ratio = 0.5;
+        shapes[2].line_lengths = yaal::LineLengths::fixed;
+        shapes[2].mean_line_length = 3;
+        shapes[2].trailing_newline = false;
+        shapes[2].blank_ratio = 0.5;
+        shapes[3].indent_width = 4;
+        shapes[3].max_depth = 40;
+        shapes[3].lines_per_level = 1;
+        shapes[3].mean_line_length = 200;
+        shapes[3].max_line_length = 1000;
+
+        for (const auto& shape : shapes) {
+            std::vector<char> doc;
+            const yaal::CorpusCounts counts = yaal::CorpusGenerator(shape, 5).generate(300000, 2, doc);
+            const yaal::CorpusCounts truth = corpus_scalar(doc);
+            expect(eq(counts.bytes, truth.bytes));
+            expect(eq(counts.eol, truth.eol));
+            expect(eq(counts.bos, truth.bos));
+            expect(eq(counts.eos, truth.eos));
+            expect(eq(counts.comments, truth.comments));
+            expect(eq(counts.blank, truth.blank));
+            if (shape.trailing_newline) expect(doc.back() == '\n');
+
+            yaal::CountingParser parser;
+            parser.parse(yaal::Buffer(doc.data(), doc.size()));
+            expect(eq(parser.counts().eol, counts.eol));
+            expect(eq(parser.counts().bos, counts.bos));
+        }
+    };
+
+    "corpus_without_trailing_newline_drops_an_empty_last_line"_test = [] {
+        yaal::CorpusShape shape;
+        shape.blank_ratio = 1;
+        shape.max_depth = 0;
+        shape.trailing_newline = false;
+        std::vector<char> doc;
+        yaal::CorpusCounts counts = yaal::CorpusGenerator(shape).generate(1000, 1, doc);
+        expect(std::all_of(doc.begin(), doc.end(), [](char c) { return c == '\n'; }));
+        expect(eq(counts.eol, uint64_t(doc.size())));
+        expect(eq(counts.blank, counts.eol));
+
+        // Half the lines blank at depth 0: some seeds end on an empty line
+        shape.blank_ratio = 0.5;
+        size_t empty_last = 0, statement_last = 0;
+        for (uint64_t seed = 0; seed < 32; seed++) {
+            counts = yaal::CorpusGenerator(shape, seed).generate(2000, 1, doc);
+            const yaal::CorpusCounts truth = corpus_scalar(doc);
+            expect(eq(counts.blank, truth.blank));
+            expect(eq(counts.blank + counts.bos, counts.eol + (doc.back() != '\n')));
+            if (doc.back() == '\n') empty_last++;
+            else statement_last++;
+        }
+        expect(empty_last > size_t{0});
+        expect(statement_last > size_t{0});
+    };
+
+    "corpus_is_deterministic_across_thread_counts"_test = [] {
+        const size_t size = 2 * yaal::CorpusGenerator::segment_size + 12345;
+        yaal::CorpusGenerator generator(yaal::CorpusShape{}, 9);
+        std::vector<char> one, three, other;
+        const yaal::CorpusCounts counts_one = generator.generate(size, 1, one);
+        const yaal::CorpusCounts counts_three = generator.generate(size, 3, three);
+        expect(one == three);
+        expect(counts_one == counts_three);
+        expect(eq(counts_one.bytes, uint64_t(one.size())));
+        expect(one.size() >= size && one.size() < size + 3 * 300);
+
+        yaal::CorpusGenerator(yaal::CorpusShape{}, 10).generate(size, 3, other);
+        expect(one != other);
+    };
+
+    "corpus_shape_knobs"_test = [] {
+        yaal::CorpusShape shape;
+        shape.utf8_ratio = 0.3;
+        shape.blank_ratio = 0;
+        std::vector<char> doc;
+        yaal::CorpusGenerator(shape).generate(200000, 1, doc);
+        expect(valid_utf8(doc));
+        expect(std::any_of(doc.begin(), doc.end(), [](char c) { return static_cast<unsigned char>(c) >= 0x80; }));
+
+        shape.utf8_ratio = 0;
+        shape.line_lengths = yaal::LineLengths::fixed;
+        shape.mean_line_length = 20;
+        shape.indent_width = 3;
+        shape.max_depth = 2;
+        yaal::CorpusGenerator(shape).generate(200000, 1, doc);
+        expect(std::none_of(doc.begin(), doc.end(), [](char c) { return static_cast<unsigned char>(c) >= 0x80; }));
+        size_t lines = 0, bad = 0;
+        for (size_t begin = 0; begin < doc.size(); lines++) {
+            const size_t end = std::find(doc.begin() + begin, doc.end(), '\n') - doc.begin();
+            size_t indent = 0;
+            while (doc[begin + indent] == ' ') indent++;
+            const size_t length = end - begin - indent;
+            if (indent % 3 != 0 || indent > 6 || length != 20 || doc[end - 1] == ' ') bad++;
+            begin = end + 1;
+        }
+        expect(eq(bad, size_t{0}));
+        expect(lines > size_t{5000});
+    };
+
+    "corpus_sidecar_round_trip"_test = [] {
+        yaal::CorpusCounts counts;
+        std::vector<char> doc;
+        counts = yaal::CorpusGenerator(yaal::CorpusShape{}).generate(50000, 1, doc);
+        std::stringstream sidecar;
+        counts.write(sidecar);
+        sidecar << "seed=42\n";
+        yaal::CorpusCounts read;
+        expect(read.read(sidecar));
+        expect(read == counts);
+
+        std::stringstream partial("bytes=1\neol=2\n");
+        expect(!read.read(partial));
+    };
+};
+
 int main() {
     return 0;
 }